@@ -0,0 +1,358 @@
+#include <memory.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <iostream>
+#include "aio.h"
+
+// The io_uring interface is used through its system calls directly,
+// so no library beyond the kernel headers is needed.
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define HAVE_URING
+#endif
+
+using namespace std;
+
+
+AsyncIO::AsyncIO(const int depth)
+{
+  this->depth = depth;
+  inFlight = 0;
+  ringFd = -1;
+  sqRing = cqRing = sqes = NULL;
+  numThreads = 0;
+  queueHead = queueTail = NULL;
+  stopping = false;
+
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&work, NULL);
+  pthread_cond_init(&finished, NULL);
+
+  if (getenv("MINIREL_NOURING") || !setupRing()) {
+    for (numThreads = 0; numThreads < AIOTHREADS; numThreads++)
+      if (pthread_create(&threads[numThreads], NULL, worker, this) != 0)
+	break;
+    if (numThreads == 0) {
+      cerr << "cannot start I/O threads" << endl;
+      exit(1);
+    }
+  }
+}
+
+
+AsyncIO::~AsyncIO()
+{
+  if (ringFd >= 0) {
+    while (inFlight > 0) {
+      (void)enter(0, 1);
+      reap();
+    }
+    closeRing();
+  }
+  else {
+    pthread_mutex_lock(&lock);
+    while (inFlight > 0)
+      pthread_cond_wait(&finished, &lock);
+    stopping = true;
+    pthread_cond_broadcast(&work);
+    pthread_mutex_unlock(&lock);
+    for (int i = 0; i < numThreads; i++)
+      pthread_join(threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&finished);
+  pthread_cond_destroy(&work);
+  pthread_mutex_destroy(&lock);
+}
+
+
+// Create an io_uring with room for depth submissions and map its
+// rings. Returns false if the kernel does not support io_uring (or
+// it is disabled), in which case the thread pool is used instead.
+
+bool AsyncIO::setupRing()
+{
+#ifdef HAVE_URING
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  int fd = syscall(__NR_io_uring_setup, depth, &p);
+  if (fd < 0)
+    return false;
+  ringFd = fd;
+
+  sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cqRingSize > sqRingSize)
+      sqRingSize = cqRingSize;
+    cqRingSize = 0;
+  }
+
+  sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+  if (sqRing == MAP_FAILED) {
+    sqRing = NULL;
+    closeRing();
+    return false;
+  }
+  if (cqRingSize == 0)
+    cqRing = sqRing;
+  else {
+    cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (cqRing == MAP_FAILED) {
+      cqRing = NULL;
+      closeRing();
+      return false;
+    }
+  }
+  sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+  sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE,
+	      MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    sqes = NULL;
+    closeRing();
+    return false;
+  }
+
+  sqTail = (unsigned*)((char*)sqRing + p.sq_off.tail);
+  sqMask = (unsigned*)((char*)sqRing + p.sq_off.ring_mask);
+  sqArray = (unsigned*)((char*)sqRing + p.sq_off.array);
+  cqHead = (unsigned*)((char*)cqRing + p.cq_off.head);
+  cqTail = (unsigned*)((char*)cqRing + p.cq_off.tail);
+  cqMask = (unsigned*)((char*)cqRing + p.cq_off.ring_mask);
+  cqes = (char*)cqRing + p.cq_off.cqes;
+
+  // the completion queue must hold a completion for every
+  // transfer that may be in flight
+  if ((int)p.cq_entries < depth) {
+    closeRing();
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+void AsyncIO::closeRing()
+{
+  if (sqes)
+    munmap(sqes, sqesSize);
+  if (cqRing && cqRing != sqRing)
+    munmap(cqRing, cqRingSize);
+  if (sqRing)
+    munmap(sqRing, sqRingSize);
+  sqes = cqRing = sqRing = NULL;
+  ::close(ringFd);
+  ringFd = -1;
+}
+
+
+// Hand toSubmit new submission queue entries to the kernel and wait
+// until at least minComplete transfers have completed.
+
+const Status AsyncIO::enter(const unsigned toSubmit,
+			    const unsigned minComplete)
+{
+#ifdef HAVE_URING
+  unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  for (;;) {
+    if (syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete,
+		flags, NULL, 0) >= 0)
+      return OK;
+    if (errno != EINTR)
+      return UNIXERR;
+  }
+#else
+  return UNIXERR;
+#endif
+}
+
+
+// Mark the transfers on the completion queue as done.
+
+void AsyncIO::reap()
+{
+#ifdef HAVE_URING
+  unsigned head = *cqHead;
+  unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+  while (head != tail) {
+    struct io_uring_cqe* cqe =
+      (struct io_uring_cqe*)cqes + (head & *cqMask);
+    IORequest* req = (IORequest*)(unsigned long)cqe->user_data;
+    req->result = cqe->res;
+    req->finished = clock();
+    req->done = true;
+    inFlight--;
+    head++;
+  }
+  __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+#endif
+}
+
+
+// Nanoseconds on the monotonic clock, for timing transfers. A
+// transfer on the io_uring counts as finished when its completion is
+// collected, which may be a little after the kernel completed it.
+
+long long AsyncIO::clock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+// Queue a transfer. If depth transfers are already in flight, wait
+// for one of them to complete first.
+
+const Status AsyncIO::submit(IORequest* req)
+{
+  req->done = false;
+  req->result = 0;
+  req->next = NULL;
+  req->queued = clock();
+
+  if (ringFd >= 0) {
+#ifdef HAVE_URING
+    pthread_mutex_lock(&lock);
+    while (inFlight >= depth) {
+      Status status = enter(0, 1);
+      if (status != OK) {
+	pthread_mutex_unlock(&lock);
+	return status;
+      }
+      reap();
+    }
+
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = req->fd;
+    if (req->sync) {
+      sqe->opcode = IORING_OP_FSYNC;
+      sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    }
+    else {
+      sqe->opcode = req->write ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe->addr = (unsigned long)&req->iov;
+      sqe->len = 1;
+      sqe->off = req->offset;
+    }
+    sqe->user_data = (unsigned long)req;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    inFlight++;
+    Status status = enter(1, 0);
+    pthread_mutex_unlock(&lock);
+    return status;
+#endif
+  }
+
+  pthread_mutex_lock(&lock);
+  while (inFlight >= depth)
+    pthread_cond_wait(&finished, &lock);
+  if (queueTail)
+    queueTail->next = req;
+  else
+    queueHead = req;
+  queueTail = req;
+  inFlight++;
+  pthread_cond_signal(&work);
+  pthread_mutex_unlock(&lock);
+  return OK;
+}
+
+
+// Wait until req has completed.
+
+void AsyncIO::wait(IORequest* req)
+{
+  if (ringFd >= 0) {
+    pthread_mutex_lock(&lock);
+    reap();
+    while (!req->done) {
+      if (enter(0, 1) != OK) {
+	req->result = -EIO;           // the ring is unusable
+	req->finished = clock();
+	break;
+      }
+      reap();
+    }
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+  while (!req->done)
+    pthread_cond_wait(&finished, &lock);
+  pthread_mutex_unlock(&lock);
+}
+
+
+// Check whether req has completed without waiting.
+
+bool AsyncIO::poll(IORequest* req)
+{
+  pthread_mutex_lock(&lock);
+  if (ringFd >= 0 && !req->done)
+    reap();
+  bool done = req->done;
+  pthread_mutex_unlock(&lock);
+  return done;
+}
+
+
+void* AsyncIO::worker(void* arg)
+{
+  ((AsyncIO*)arg)->runQueue();
+  return NULL;
+}
+
+
+// Main loop of a pool thread: take transfers off the queue and
+// carry them out until the engine shuts down.
+
+void AsyncIO::runQueue()
+{
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (!queueHead && !stopping)
+      pthread_cond_wait(&work, &lock);
+    if (!queueHead)
+      break;
+
+    IORequest* req = queueHead;
+    queueHead = req->next;
+    if (!queueHead)
+      queueTail = NULL;
+    pthread_mutex_unlock(&lock);
+
+    ssize_t nbytes;
+    if (req->sync)
+      nbytes = fdatasync(req->fd);
+    else if (req->write)
+      nbytes = pwritev(req->fd, &req->iov, 1, req->offset);
+    else
+      nbytes = preadv(req->fd, &req->iov, 1, req->offset);
+    int result = nbytes >= 0 ? (int)nbytes : -errno;
+
+    pthread_mutex_lock(&lock);
+    req->result = result;
+    req->finished = clock();
+    req->done = true;
+    inFlight--;
+    pthread_cond_broadcast(&finished);
+  }
+  pthread_mutex_unlock(&lock);
+}
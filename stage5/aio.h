@@ -0,0 +1,109 @@
+#ifndef AIO_H
+#define AIO_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include "error.h"
+
+class File;
+
+// one asynchronous page transfer, or an fdatasync of the file. A
+// request is created by File::readPageAsync or File::writePageAsync
+// and freed by File::waitIO once it has completed.
+
+struct IORequest
+{
+  const File* file;     // file the page belongs to
+  int   pageNo;         // page number within file
+  int   fd;             // unix file to transfer from or to
+  off_t offset;         // byte offset of page in unix file
+  struct iovec iov;     // page buffer
+  bool  write;          // true for a write, false for a read
+  bool  sync;           // true for an fdatasync; iov is unused
+  bool  done;           // true once the transfer has completed
+  int   result;         // # of bytes transferred, or -errno
+  long long queued;     // AsyncIO::clock() when submitted
+  long long finished;   // AsyncIO::clock() when seen to be complete
+  IORequest* next;      // next request in the engine's queue
+};
+
+// completion handle of a transfer; NULL stands for a transfer that
+// was carried out synchronously and is complete
+
+typedef IORequest* IOHandle;
+
+// max. # of transfers in flight, and # of threads of the fallback
+// engine
+
+const int AIODEPTH = 64;
+const int AIOTHREADS = 4;
+
+// The I/O engine queues transfers and completes them in the
+// background. It uses an io_uring submission/completion queue pair
+// where the kernel has one; otherwise a small pool of threads runs
+// the transfers with preadv/pwritev; setting MINIREL_NOURING in the
+// environment forces the thread pool. Any thread may submit and wait
+// for requests; the io_uring is only touched under the engine lock.
+
+class AsyncIO
+{
+ public:
+  AsyncIO(const int depth);
+  ~AsyncIO();
+
+  const Status submit(IORequest* req);  // start a transfer
+  void wait(IORequest* req);            // wait until req has completed
+  bool poll(IORequest* req);            // has req completed?
+
+  bool usingUring() const               // is io_uring in use?
+  {
+	return ringFd >= 0;
+  }
+  int pending() const                   // # of transfers in flight
+  {
+	return inFlight;
+  }
+  static long long clock();             // ns on the monotonic clock
+
+ private:
+  int depth;                            // max. # of transfers in flight
+  int inFlight;                         // # of transfers in flight
+
+  // io_uring state; ringFd is -1 if the thread pool is used
+  int ringFd;
+  void* sqRing;                         // submission ring mapping
+  size_t sqRingSize;
+  void* cqRing;                         // completion ring mapping
+  size_t cqRingSize;
+  void* sqes;                           // submission queue entries
+  size_t sqesSize;
+  unsigned* sqTail;
+  unsigned* sqMask;
+  unsigned* sqArray;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned* cqMask;
+  void* cqes;
+
+  bool setupRing();                     // create the io_uring, if possible
+  void closeRing();
+  const Status enter(const unsigned toSubmit, const unsigned minComplete);
+  void reap();                          // collect completed transfers
+
+  // thread pool state
+  pthread_t threads[AIOTHREADS];
+  int numThreads;
+  pthread_mutex_t lock;                 // protects the ring, inFlight and
+                                        // everything below
+  pthread_cond_t work;                  // signalled when queue is not empty
+  pthread_cond_t finished;              // signalled when a transfer completes
+  IORequest* queueHead;                 // FIFO of queued transfers
+  IORequest* queueTail;
+  bool stopping;                        // tells the threads to exit
+
+  static void* worker(void* arg);       // thread pool main loop
+  void runQueue();
+};
+
+#endif
@@ -5,6 +5,10 @@
 #include <fcntl.h>
 #include <iostream>
 #include <stdio.h>
+#include <time.h>
+#include <ctype.h>
+#include <limits.h>
+#include <sys/mman.h>
 #include "page.h"
 #include "buf.h"
 
@@ -15,157 +19,908 @@
 		     } \
                    }
 
+// Latching rules. A thread may take the latch of a hash table
+// partition while holding a frame latch, but never the other way
+// round, and only flushFile, flushAll, checkpoint and the background
+// writer (serialized by flushLatch) hold more than one frame latch,
+// which they take in frame order or with trylock.
+// A frame is pinned only under the latch of its partition, and it
+// is only taken out of the hash table under that latch after
+// checking that it is unpinned, so a pinned frame keeps its page.
+// The replacement policy's own lock, if it has one, is taken last.
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(const int bufs)
+BufMgr::BufMgr(const int bufs, const ReplPolicy policy)
 {
     numBufs = bufs;
+    this->policy = policy;
 
-    bufTable = new BufDesc[bufs];
-    memset(bufTable, 0, bufs * sizeof(BufDesc));
-    for (int i = 0; i < bufs; i++) 
+    // a chunk holds a power of 2 frames, as PAGESIZE is a power of 2
+    chunkShift = 0;
+    while ((PAGESIZE << (chunkShift + 1)) <= (unsigned)BUFCHUNKSIZE)
+        chunkShift++;
+    numChunks = 0;
+    descChunks = NULL;
+    pageChunks = NULL;
+    hugePages = getenv("MINIREL_HUGEPAGES") != NULL;
+    if (addChunks(bufs) != OK)
     {
-        bufTable[i].frameNo = i;
-        bufTable[i].valid = false;
+        cerr << "cannot allocate buffer pool of " << bufs << " pages" << endl;
+        exit(1);
     }
 
-    bufPool = new Page[bufs];
-    memset(bufPool, 0, bufs * sizeof(Page));
+    hashTable = new BufHashTbl (bufs);  // allocate the buffer hash table
+    replacer = Replacer::create(policy, bufs);
 
-    int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-    hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+    pthread_mutex_init(&flushLatch, NULL);
+    for (int i = 0; i < BUFLATCHES; i++)
+        pthread_mutex_init(&listLatches[i], NULL);
+    flushList = new BufDesc* [bufs];
+    latchList = new BufDesc* [bufs];
+    runPages = new const Page* [bufs];
 
-    clockHand = bufs - 1;
+    writerRunning = writerStop = writerKicked = false;
+    pthread_mutex_init(&writerLock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&writerWake, &attr);
+    pthread_condattr_destroy(&attr);
 }
 
 
 BufMgr::~BufMgr() {
 
+    stopWriter();
+
     // flush out all unwritten pages
+    int count = 0;
     for (int i = 0; i < numBufs; i++) 
     {
-        BufDesc* tmpbuf = &bufTable[i];
-        if (tmpbuf->valid == true && tmpbuf->dirty == true) {
+        BufDesc* tmpbuf = frameDesc(i);
+        if (tmpbuf->io)
+            (void)finishIO(i);
+        if (tmpbuf->valid == true && takeDirty(tmpbuf))
+            flushList[count++] = tmpbuf;
+    }
+    writeDirty(flushList, count);
 
-#ifdef DEBUGBUF
-            cout << "flushing page " << tmpbuf->pageNo
-                 << " from frame " << i << endl;
+    // files still open keep no list of frames that are gone
+    for (int i = 0; i < numBufs; i++)
+    {
+        if (frameDesc(i)->valid && frameDesc(i)->file)
+            frameDesc(i)->file->bufFrames = -1;
+    }
+    freeChunks(0);
+    pthread_mutex_destroy(&flushLatch);
+    for (int i = 0; i < BUFLATCHES; i++)
+        pthread_mutex_destroy(&listLatches[i]);
+    pthread_cond_destroy(&writerWake);
+    pthread_mutex_destroy(&writerLock);
+    delete [] flushList;
+    delete [] latchList;
+    delete [] runPages;
+    delete [] descChunks;
+    delete [] pageChunks;
+    delete hashTable;
+    delete replacer;
+}
+
+
+// Allocate chunks until there are frames for bufs pages. The pages
+// of a chunk are one anonymous mapping, which starts on a page
+// boundary as direct I/O needs and which the kernel fills in as
+// frames are first used. The new frames are empty.
+
+const Status BufMgr::addChunks(const int bufs)
+{
+    int chunks = (bufs + (1 << chunkShift) - 1) >> chunkShift;
+    if (chunks <= numChunks)
+        return OK;
+
+    BufDesc** descs = new BufDesc* [chunks];
+    Page** pages = new Page* [chunks];
+    for (int i = 0; i < numChunks; i++)
+    {
+        descs[i] = descChunks[i];
+        pages[i] = pageChunks[i];
+    }
+    delete [] descChunks;
+    delete [] pageChunks;
+    descChunks = descs;
+    pageChunks = pages;
+
+    for (; numChunks < chunks; numChunks++)
+    {
+        void* addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (hugePages)
+            addr = mmap(NULL, BUFCHUNKSIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
 #endif
+        if (addr == MAP_FAILED)
+        {
+            addr = mmap(NULL, BUFCHUNKSIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (addr == MAP_FAILED)
+                return UNIXERR;
+#ifdef MADV_HUGEPAGE
+            // no huge pages reserved; ask for transparent ones
+            if (hugePages)
+                (void)madvise(addr, BUFCHUNKSIZE, MADV_HUGEPAGE);
+#endif
+        }
+        pageChunks[numChunks] = (Page*)addr;
 
-            tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]));
+        BufDesc* chunk = new BufDesc[1 << chunkShift];
+        for (int i = 0; i < (1 << chunkShift); i++)
+        {
+            chunk[i].frameNo = (numChunks << chunkShift) + i;
+            chunk[i].fileNext = chunk[i].filePrev = -1;
+            pthread_mutex_init(&chunk[i].latch, NULL);
         }
+        descChunks[numChunks] = chunk;
+    }
+    return OK;
+}
+
+
+// Release all chunks but the first chunks. Their frames must be
+// empty.
+
+void BufMgr::freeChunks(const int chunks)
+{
+    for (; numChunks > chunks; numChunks--)
+    {
+        BufDesc* chunk = descChunks[numChunks - 1];
+        for (int i = 0; i < (1 << chunkShift); i++)
+            pthread_mutex_destroy(&chunk[i].latch);
+        delete [] chunk;
+        munmap(pageChunks[numChunks - 1], BUFCHUNKSIZE);
+    }
+}
+
+
+// Write out the dirty pages in frames bufs and above and take all
+// pages there out of the pool. Nothing is taken out if one of the
+// frames is pinned.
+
+const Status BufMgr::evictFrames(const int bufs)
+{
+    Status status;
+
+    for (int i = bufs; i < numBufs; i++)
+    {
+        BufDesc* desc = frameDesc(i);
+        if (desc->io && (status = finishIO(i)) != OK)
+            return status;
+        if (desc->pins() > 0)
+            return PAGEPINNED;
     }
 
-    delete [] bufTable;
-    delete [] bufPool;
+    int count = 0;
+    for (int i = bufs; i < numBufs; i++)
+        if (frameDesc(i)->valid && takeDirty(frameDesc(i)))
+            flushList[count++] = frameDesc(i);
+    if ((status = writeDirty(flushList, count)) != OK)
+        return status;
+
+    for (int i = bufs; i < numBufs; i++)
+    {
+        BufDesc* desc = frameDesc(i);
+        if (!desc->valid)
+            continue;
+        hashTable->remove(desc->file, desc->pageNo);
+        unlinkFrame(desc);
+        desc->Clear();
+    }
+    return OK;
+}
+
+
+// Size the hash table, the replacement policy and the scratch lists
+// for numBufs frames, and enter the pages in the pool anew. The
+// policy starts over, as if each page had been read in once.
+
+void BufMgr::rebuild()
+{
     delete hashTable;
+    delete replacer;
+    hashTable = new BufHashTbl (numBufs);
+    replacer = Replacer::create(policy, numBufs);
+    for (int i = 0; i < numBufs; i++)
+    {
+        BufDesc* desc = frameDesc(i);
+        if (!desc->valid)
+            continue;
+        Status status = hashTable->insert(desc->file, desc->pageNo, i);
+        ASSERT(status == OK);
+        replacer->loaded(i, desc->file, desc->pageNo, true);
+    }
+
+    delete [] flushList;
+    delete [] latchList;
+    delete [] runPages;
+    flushList = new BufDesc* [numBufs];
+    latchList = new BufDesc* [numBufs];
+    runPages = new const Page* [numBufs];
+}
+
+
+// Change the pool to bufs frames. New frames are added empty; when
+// the pool shrinks, the pages in the frames given up are written out
+// if dirty and dropped, and the memory of those frames is released.
+// The background writer is stopped meanwhile.
+
+const Status BufMgr::resize(const int bufs)
+{
+    if (bufs < 1)
+        return BADPOOLSIZE;
+    if (bufs == numBufs)
+        return OK;
+
+    bool writing = __atomic_load_n(&writerRunning, __ATOMIC_ACQUIRE);
+    stopWriter();
+
+    Status status;
+    if (bufs > numBufs)
+        status = addChunks(bufs);
+    else if ((status = evictFrames(bufs)) == OK)
+    {
+        int chunks = (bufs + (1 << chunkShift) - 1) >> chunkShift;
+        freeChunks(chunks);
+
+        // give back the memory pages past the last frame in use
+        size_t used = (size_t)(bufs - ((chunks - 1) << chunkShift)) * PAGESIZE;
+        size_t pageSize = getpagesize();
+        used = (used + pageSize - 1) / pageSize * pageSize;
+        if (used < (size_t)BUFCHUNKSIZE)
+            (void)madvise((char*)pageChunks[chunks - 1] + used,
+                          BUFCHUNKSIZE - used, MADV_DONTNEED);
+    }
+    if (status == OK)
+    {
+        numBufs = bufs;
+        rebuild();
+    }
+
+    if (writing)
+    {
+        Status writerStatus = startWriter(writerConfig);
+        if (status == OK)
+            status = writerStatus;
+    }
+    return status;
 }
 
 
-const Status BufMgr::allocBuf(int & frame) 
+// Number of frames a pool size given as text stands for. A plain
+// number is a # of frames; a number followed by K, M or G, with or
+// without a B, is a # of bytes the pages of the pool may take.
+
+const Status BufMgr::poolFrames(const char* size, int & frames)
 {
-    // perform first part of clock algorithm to search for 
-    // open buffer frame
-    // Assumes non-concurrent access to buffer manager
+    char* end;
+    errno = 0;
+    long long n = strtoll(size, &end, 10);
+    if (errno != 0 || end == size || n < 1 || n > INT_MAX)
+        return BADPOOLSIZE;
+
+    long long unit = 0;
+    switch (toupper(*end))
+    {
+    case 'K': unit = 1LL << 10; break;
+    case 'M': unit = 1LL << 20; break;
+    case 'G': unit = 1LL << 30; break;
+    }
+    if (unit > 0)
+    {
+        end++;
+        if (toupper(*end) == 'B')
+            end++;
+        n = n * unit / PAGESIZE;
+    }
+    if (*end != '\0' || n < 1 || n > INT_MAX)
+        return BADPOOLSIZE;
+
+    frames = (int)n;
+    return OK;
+}
+
+
+// Find a frame for a new page among the frames offered by the
+// replacement policy, or in the ring of a strategy. The frame
+// returned is latched, unpinned, empty and not in the hash table. A
+// frame latched by another thread is passed over rather than waited
+// for.
+
+const Status BufMgr::allocBuf(int & frame, BufStrategy* strategy) 
+{
+    if (strategy && reuseRing(strategy, frame))
+        return OK;
+
     Status status = OK;
-    int numScanned = 0;
-    bool found = 0;
-    while (numScanned < 2*numBufs)
+    int busy = -1;      // an unpinned frame with a transfer in progress
+    ReplCursor cursor;
+    int frameNo;
+    while ((frameNo = replacer->victim(cursor)) >= 0)
     {
-        // advance the clock
-        advanceClock();
-        numScanned++;
+        BufDesc* desc = frameDesc(frameNo);
+
+        if (pthread_mutex_trylock(&desc->latch) != 0)
+            continue;
 
+        // collect a transfer of the frame that has completed
+        if (desc->io && File::ioDone(desc->io))
+        {
+            bool write = desc->io->write;
+            status = finishIO(frameNo);
+            if (status != OK && write)
+            {
+                pthread_mutex_unlock(&desc->latch);
+                return status;
+            }
+        }
+
+        // frames still being read or written cannot be replaced yet
+        if (desc->io)
+        {
+            if (busy < 0 && desc->pins() == 0) busy = frameNo;
+        }
         // if invalid, use frame
-        if (! bufTable[clockHand].valid)
+        else if (! desc->valid)
         {
-            break;
+            if (desc->pins() == 0)
+            {
+                frame = frameNo;
+                return OK;
+            }
+        }
+        else if (desc->pins() == 0)
+        {
+            // is not pinned. Make sure no one pins it while it is
+            // being taken out of the table.
+            pthread_mutex_t* part = hashTable->latch(desc->file, desc->pageNo);
+            pthread_mutex_lock(part);
+            if (desc->pins() == 0)
+            {
+                // a dirty frame is written out in the background and
+                // the search goes on for a clean one; the background
+                // writer should have cleaned it, so it is woken up
+                if (desc->dirty)
+                {
+                    kickWriter();
+                    desc->evictWrite = true;
+                    if ((status = startWrite(desc)) != OK)
+                    {
+                        pthread_mutex_unlock(part);
+                        pthread_mutex_unlock(&desc->latch);
+                        return status;
+                    }
+                }
+
+                if (desc->io)
+                {
+                    if (busy < 0) busy = frameNo;
+                }
+                else
+                {
+                    // remove previous entry from hash table
+                    hashTable->remove(desc->file, desc->pageNo);
+                    pthread_mutex_unlock(part);
+                    evicted(desc, false);
+                    replacer->replaced(frameNo);
+                    unlinkFrame(desc);
+                    desc->Clear();
+                    frame = frameNo;
+                    return OK;
+                }
+            }
+            pthread_mutex_unlock(part);
         }
 
-        // is valid, check referenced bit
-        if (! bufTable[clockHand].refbit)
+        pthread_mutex_unlock(&desc->latch);
+    }
+
+    // if all replaceable frames are busy, wait for one of them
+    if (busy >= 0)
+    {
+        BufDesc* desc = frameDesc(busy);
+        pthread_mutex_lock(&desc->latch);
+        if (desc->io && (status = finishIO(busy)) != OK)
         {
-            // check to see if someone has it pinned
-            if (bufTable[clockHand].pinCnt == 0)
+            pthread_mutex_unlock(&desc->latch);
+            return status;
+        }
+
+        if (! desc->valid)
+        {
+            if (desc->pins() == 0)
             {
-                // hasn't been referenced and is not pinned, use it
-
-                // remove previous entry from hash table
-                status = hashTable->remove(bufTable[clockHand].file, 
-                                           bufTable[clockHand].pageNo);
-                found = true;
-                //if (status != OK) return status;
-                break;
+                frame = busy;
+                return OK;
             }
         }
-        else
+        else if (desc->pins() == 0 && !desc->dirty)
         {
-            // has been referenced, clear the bit
-            bufStats.accesses++;
-            bufTable[clockHand].refbit = false;
+            pthread_mutex_t* part = hashTable->latch(desc->file, desc->pageNo);
+            pthread_mutex_lock(part);
+            if (desc->pins() == 0)
+            {
+                hashTable->remove(desc->file, desc->pageNo);
+                pthread_mutex_unlock(part);
+                evicted(desc, false);
+                replacer->replaced(busy);
+                unlinkFrame(desc);
+                desc->Clear();
+                frame = busy;
+                return OK;
+            }
+            pthread_mutex_unlock(part);
         }
+        pthread_mutex_unlock(&desc->latch);
+    }
+
+    // the buffer pool is full
+    return BUFFEREXCEEDED;
+} // end allocBuf
+
+
+// Start writing out a dirty frame that is not pinned. The caller
+// holds the latches of the frame and of its partition.
+
+const Status BufMgr::startWrite(BufDesc* desc)
+{
+    long long start = AsyncIO::clock();
+    Status status = desc->file->writePageAsync(desc->pageNo,
+                                               framePage(desc->frameNo),
+                                               desc->io);
+    if (status != OK)
+        return status;
+    desc->dirty = false;
+    if (!desc->io)
+    {
+        addStat(bufStats.diskwrites); // written synchronously
+        addLatency(bufStats.writeLatency, AsyncIO::clock() - start);
     }
-    
-    // check for full buffer pool
-    if (!found && numScanned >= 2*numBufs)
+    return OK;
+}
+
+
+// Count a transfer that took nanos ns in a latency histogram.
+
+void BufMgr::addLatency(long long histogram[], const long long nanos)
+{
+    long long us = nanos / 1000;
+    int bucket = 0;
+    while (us > 0 && bucket < LATENCYBUCKETS - 1)
     {
-        return BUFFEREXCEEDED;
+        us >>= 1;
+        bucket++;
     }
-    
-    // flush any existing changes to disk if necessary
-    if (bufTable[clockHand].dirty)
+    addStat(histogram[bucket]);
+}
+
+
+// Count the eviction of the page in a latched frame, in the pool's
+// counters and in those of the page's file.
+
+void BufMgr::evicted(const BufDesc* desc, const bool ring)
+{
+    addStat(bufStats.evictions);
+    addStat(desc->file->bufStats.evictions);
+    if (desc->evictWrite)
     {
-        bufStats.diskwrites++;
+        addStat(bufStats.dirtyEvictions);
+        addStat(desc->file->bufStats.dirtyEvictions);
+    }
+    if (ring)
+        addStat(bufStats.ringEvictions);
+}
 
-        status = bufTable[clockHand].file->writePage(bufTable[clockHand].pageNo,
-                                                     &bufPool[clockHand]);
-        if (status != OK) return status;
+
+BufStrategy::BufStrategy(const BufAccess access)
+{
+    this->access = access;
+    switch (access)
+    {
+    case BULKREAD:  size = BULKREADRING; break;
+    case BULKWRITE: size = BULKWRITERING; break;
+    default:        size = NOCACHERING; break;
     }
+    next = current = 0;
+    frames = new int[size];
+    files = new const File* [size];
+    pageNos = new int[size];
+    for (int i = 0; i < size; i++)
+        frames[i] = -1;
+}
 
-    // return new frame number
-    frame = clockHand;
 
-    return OK;
-} // end allocBuf
+BufStrategy::~BufStrategy()
+{
+    delete [] frames;
+    delete [] files;
+    delete [] pageNos;
+}
+
 
-	
-const Status BufMgr::readPage(File* file, const int PageNo, Page*& page)
+// A ring never takes more than a quarter of the pool.
+
+int BufMgr::ringSize(const BufStrategy* strategy) const
 {
-    // check to see if it is already in the buffer pool
-    // cout << "readPage called on file.page " << file << "." << PageNo << endl;
-    int frameNo = 0;
-    Status status = hashTable->lookup(file, PageNo, frameNo);
+    int size = numBufs / 4;
+    return strategy->size < size ? strategy->size : size;
+}
+
+
+// Take the frame of the next slot of the ring for a new page, if it
+// still holds the page the ring put there and nobody has it pinned.
+// Otherwise the frame is left to the replacement policy and false is
+// returned; the caller then allocates a frame from the pool, which
+// takes the slot.
+
+bool BufMgr::reuseRing(BufStrategy* strategy, int & frame)
+{
+    int size = ringSize(strategy);
+    if (size < 1)
+        return false;
+    int slot = strategy->current = strategy->next % size;
+    strategy->next = (slot + 1) % size;
+    if (size > 1)
+        writeBehind(strategy, (slot + size / 2) % size);
+
+    int frameNo = strategy->frames[slot];
+    if (frameNo < 0 || frameNo >= numBufs)   // pool shrunk since
+        return false;
+    strategy->frames[slot] = -1;
+    BufDesc* desc = frameDesc(frameNo);
+    if (pthread_mutex_trylock(&desc->latch) != 0)
+        return false;
+
+    // wait for the write started half a ring ago
+    if (desc->io && finishIO(frameNo) != OK)
+    {
+        pthread_mutex_unlock(&desc->latch);
+        return false;
+    }
+    if (!desc->valid || desc->file != strategy->files[slot]
+        || desc->pageNo != strategy->pageNos[slot])
+    {
+        pthread_mutex_unlock(&desc->latch);
+        return false;
+    }
+
+    pthread_mutex_t* part = hashTable->latch(desc->file, desc->pageNo);
+    pthread_mutex_lock(part);
+    if (desc->pins() > 0 || desc->dirty)
+    {
+        pthread_mutex_unlock(part);
+        pthread_mutex_unlock(&desc->latch);
+        return false;
+    }
+    hashTable->remove(desc->file, desc->pageNo);
+    pthread_mutex_unlock(part);
+    evicted(desc, true);
+    replacer->dropped(frameNo);
+    unlinkFrame(desc);
+    desc->Clear();
+    frame = frameNo;
+    return true;
+}
+
+
+// Start writing out the page in a slot of the ring if it is dirty
+// and no longer pinned, so that it is clean by the time the slot is
+// reused.
+
+void BufMgr::writeBehind(BufStrategy* strategy, const int slot)
+{
+    int frameNo = strategy->frames[slot];
+    if (frameNo < 0 || frameNo >= numBufs)
+        return;
+    BufDesc* desc = frameDesc(frameNo);
+    if (pthread_mutex_trylock(&desc->latch) != 0)
+        return;
+    if (desc->valid && !desc->io && desc->file == strategy->files[slot]
+        && desc->pageNo == strategy->pageNos[slot])
+    {
+        pthread_mutex_t* part = hashTable->latch(desc->file, desc->pageNo);
+        pthread_mutex_lock(part);
+        if (desc->pins() == 0 && desc->dirty)
+        {
+            desc->evictWrite = true;
+            (void)startWrite(desc);     // on failure the page stays dirty
+        }
+        pthread_mutex_unlock(part);
+    }
+    pthread_mutex_unlock(&desc->latch);
+}
+
+
+// Record the page just put into frame in the slot being filled.
+
+void BufMgr::ringAdd(BufStrategy* strategy, const int frame,
+                     const File* file, const int pageNo)
+{
+    if (ringSize(strategy) < 1)
+        return;
+    strategy->frames[strategy->current] = frame;
+    strategy->files[strategy->current] = file;
+    strategy->pageNos[strategy->current] = pageNo;
+}
+
+
+// Wait for the read or write in progress on a frame to complete. The
+// caller holds the frame's latch. A frame whose read failed is
+// emptied, though threads that pinned it in the meantime keep their
+// pins; one whose write failed is marked dirty again.
+
+const Status BufMgr::finishIO(const int frame)
+{
+    BufDesc* desc = frameDesc(frame);
+    IOHandle io = desc->io;
+    bool write = io->write;
+    long long nanos;
+
+    Status status = File::waitIO(io, &nanos);
+    __atomic_store_n(&desc->io, (IOHandle)NULL, __ATOMIC_RELEASE);
+    addLatency(write ? bufStats.writeLatency : bufStats.readLatency, nanos);
     if (status == OK)
     {
-        // set the referenced bit
-        bufTable[frameNo].refbit = true;
-        bufTable[frameNo].pinCnt++;
-        page = &bufPool[frameNo];
+        if (write) addStat(bufStats.diskwrites);
     }
-    else // not in the buffer pool, must allocate a new page
+    else if (write)
+        desc->dirty = true;
+    else
     {
-        // alloc a new frame
-        status = allocBuf(frameNo);
-        if (status != OK) return status;
+        pthread_mutex_t* part = hashTable->latch(desc->file, desc->pageNo);
+        pthread_mutex_lock(part);
+        hashTable->remove(desc->file, desc->pageNo);
+        pthread_mutex_unlock(part);
+        replacer->dropped(frame);
+        unlinkFrame(desc);
+        desc->file = NULL;
+        desc->pageNo = -1;
+        desc->valid = false;
+    }
+    return status;
+}
+
+
+// Put a frame that was just given a page on the list of frames of
+// the page's file. The caller holds the frame's latch.
+
+void BufMgr::linkFrame(BufDesc* desc)
+{
+    File* file = desc->file;
+    pthread_mutex_t* latch = listLatch(file);
+    pthread_mutex_lock(latch);
+    desc->filePrev = -1;
+    desc->fileNext = file->bufFrames;
+    if (file->bufFrames >= 0)
+        frameDesc(file->bufFrames)->filePrev = desc->frameNo;
+    file->bufFrames = desc->frameNo;
+    pthread_mutex_unlock(latch);
+}
+
+
+// Take a frame off the list of its file before it gives up its
+// page. The caller holds the frame's latch.
+
+void BufMgr::unlinkFrame(BufDesc* desc)
+{
+    File* file = desc->file;
+    pthread_mutex_t* latch = listLatch(file);
+    pthread_mutex_lock(latch);
+    if (desc->filePrev >= 0)
+        frameDesc(desc->filePrev)->fileNext = desc->fileNext;
+    else
+        file->bufFrames = desc->fileNext;
+    if (desc->fileNext >= 0)
+        frameDesc(desc->fileNext)->filePrev = desc->filePrev;
+    desc->fileNext = desc->filePrev = -1;
+    pthread_mutex_unlock(latch);
+}
+
+
+// A frame that was just pinned may still be in the middle of a read
+// by another thread, a prefetch or a write back. Wait for that to
+// finish; if the page could not be read, drop the pin again.
+
+const Status BufMgr::waitFrame(const int frame)
+{
+    BufDesc* desc = frameDesc(frame);
+    Status status = OK;
+
+    if (__atomic_load_n(&desc->loading, __ATOMIC_ACQUIRE)
+        || __atomic_load_n(&desc->io, __ATOMIC_ACQUIRE))
+    {
+        long long start = AsyncIO::clock();
+        pthread_mutex_lock(&desc->latch);
+        if (desc->io)
+            status = finishIO(frame);
+        pthread_mutex_unlock(&desc->latch);
+        addStat(bufStats.pinWaits);
+        addStat(bufStats.pinWaitNanos, AsyncIO::clock() - start);
+    }
+
+    if (status == OK && !desc->valid)
+        status = UNIXERR;               // the read of the page failed
+    if (status != OK)
+        desc->unpin();
+    return status;
+}
+
 
-        // read the page into the new frame
-        bufStats.diskreads++;
-        status = file->readPage(PageNo, &bufPool[frameNo]);
+const Status BufMgr::readPage(File* file, const int PageNo, Page*& page,
+                              BufStrategy* strategy)
+{
+    pthread_mutex_t* part = hashTable->latch(file, PageNo);
+    Status status;
+    int frameNo = 0;
+
+    addStat(bufStats.accesses);
+    for (;;)
+    {
+        // check to see if it is already in the buffer pool
+        pthread_mutex_lock(part);
+        status = hashTable->lookup(file, PageNo, frameNo);
+        if (status == OK)
+        {
+            // pin the page and tell the policy it was referenced
+            BufDesc* desc = frameDesc(frameNo);
+            desc->pin();
+            pthread_mutex_unlock(part);
+
+            if ((status = waitFrame(frameNo)) != OK) return status;
+            addStat(file->bufStats.hits);
+            if (__atomic_load_n(&desc->readAhead, __ATOMIC_RELAXED)
+                && __atomic_exchange_n(&desc->readAhead, false,
+                                       __ATOMIC_RELAXED))
+                addStat(bufStats.readAheadHits);
+            replacer->touched(frameNo);
+            if (desc->mapped)
+                page = desc->mapped;
+            else
+                page = framePage(frameNo);
+            return OK;
+        }
+        pthread_mutex_unlock(part);
+
+        // not in the buffer pool, must allocate a new page
+        status = allocBuf(frameNo, strategy);
         if (status != OK) return status;
+        BufDesc* desc = frameDesc(frameNo);
 
-        // set up the entry properly
-        bufTable[frameNo].Set(file, PageNo);
-        page = &bufPool[frameNo];
+        // another thread may have read the page in the meantime; if
+        // so, give the frame back and use that one
+        int otherFrame;
+        pthread_mutex_lock(part);
+        if (hashTable->lookup(file, PageNo, otherFrame) == OK)
+        {
+            pthread_mutex_unlock(part);
+            pthread_mutex_unlock(&desc->latch);
+            continue;
+        }
 
-        // insert in the hash table
+        // set up the entry properly and insert it in the hash table.
+        // Threads that find the page before it has been read wait
+        // for the frame's latch.
+        desc->Set(file, PageNo);
+        desc->loading = true;
         status = hashTable->insert(file, PageNo, frameNo);
-        if (status != OK) { return status; }
+        if (status == OK)
+            replacer->loaded(frameNo, file, PageNo,
+                             !strategy || strategy->access != NOCACHE);
+        pthread_mutex_unlock(part);
+        if (status != OK)
+        {
+            desc->Clear();
+            pthread_mutex_unlock(&desc->latch);
+            return status;
+        }
+        linkFrame(desc);
+        if (strategy)
+            ringAdd(strategy, frameNo, file, PageNo);
+
+        // read the page into the new frame. A page of a mapped
+        // file is not copied; the frame points into the mapping.
+        Page* mapped = NULL;
+        if (file->isMapped())
+            status = file->mapPage(PageNo, mapped);
+        else
+        {
+            long long start = AsyncIO::clock();
+            addStat(bufStats.diskreads);
+            status = file->readPage(PageNo, framePage(frameNo));
+            addLatency(bufStats.readLatency, AsyncIO::clock() - start);
+        }
+        addStat(bufStats.misses);
+        addStat(file->bufStats.misses);
+
+        if (status != OK)
+        {
+            pthread_mutex_lock(part);
+            hashTable->remove(file, PageNo);
+            pthread_mutex_unlock(part);
+            replacer->dropped(frameNo);
+            unlinkFrame(desc);
+            desc->file = NULL;
+            desc->pageNo = -1;
+            desc->valid = false;
+            desc->unpin();
+        }
+        desc->mapped = mapped;
+        __atomic_store_n(&desc->loading, false, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&desc->latch);
+        if (status != OK) return status;
 
+        if (mapped)
+            page = mapped;
+        else
+            page = framePage(frameNo);
+        return OK;
     }
+}
 
-    return OK;
+
+// Start reading a page into the buffer pool without waiting for it,
+// so that a later readPage finds it there. The page is not pinned.
+// A scan reading through a ring prefetches into the ring as well.
+// Mapped files are only advised that the page will be needed.
+
+const Status BufMgr::prefetchPage(File* file, const int PageNo,
+                                  BufStrategy* strategy)
+{
+    pthread_mutex_t* part = hashTable->latch(file, PageNo);
+    int frameNo = 0;
+
+    pthread_mutex_lock(part);
+    Status status = hashTable->lookup(file, PageNo, frameNo);
+    pthread_mutex_unlock(part);
+    if (status == OK)
+        return OK;
+    if (file->isMapped())
+        return file->advise(PageNo, 1, WILLNEED);
+
+    status = allocBuf(frameNo, strategy);
+    if (status != OK) return status;
+    BufDesc* desc = frameDesc(frameNo);
+
+    // start the read while entering the page in the hash table, so
+    // that a thread finding the page also finds the read in progress
+    int otherFrame;
+    pthread_mutex_lock(part);
+    if (hashTable->lookup(file, PageNo, otherFrame) != OK)
+    {
+        IOHandle io;
+        status = file->readPageAsync(PageNo, framePage(frameNo), io);
+        if (status == OK)
+        {
+            addStat(bufStats.diskreads);
+            desc->Set(file, PageNo);
+            desc->pinCnt = 0;
+            desc->io = io;
+            desc->readAhead = true;
+            status = hashTable->insert(file, PageNo, frameNo);
+            if (status == OK)
+                replacer->loaded(frameNo, file, PageNo, false);
+        }
+    }
+    pthread_mutex_unlock(part);
+    if (status == OK && desc->file == file)
+    {
+        linkFrame(desc);
+        if (strategy)
+            ringAdd(strategy, frameNo, file, PageNo);
+    }
+    pthread_mutex_unlock(&desc->latch);
+
+    return status;
 }
 
 
@@ -173,85 +928,507 @@ const Status BufMgr::unPinPage(File* file, const int PageNo,
 			       const bool dirty) 
 {
     // lookup in hashtable
+    pthread_mutex_t* part = hashTable->latch(file, PageNo);
     Status status = OK;
     int frameNo = 0;
+    pthread_mutex_lock(part);
     status = hashTable->lookup(file, PageNo, frameNo);
-    if (status != OK) return status;
-    /*
-    if (status != OK) {cout << "lookup failed in unpinpage\n"; return status;}
-    cout << "unpinning (file.page) " << file << "." << PageNo << " with dirty flag = " << dirty << endl;
-    cout << "\t page is in frame " << frameNo << " pinCnt is " << bufTable[frameNo].pinCnt  << endl;
-    */
+    if (status == OK)
+    {
+        BufDesc* desc = frameDesc(frameNo);
 
-    if (dirty == true) bufTable[frameNo].dirty = dirty;
+        // make sure the page is actually pinned
+        if (!desc->unpin())
+            status = PAGENOTPINNED;
 
-    // make sure the page is actually pinned
-    if (bufTable[frameNo].pinCnt == 0)
-    {
-        return PAGENOTPINNED;
+        // pages of a mapped file are read-only: the pin is dropped
+        // all the same, but the page is not marked dirty
+        else if (dirty == true && desc->mapped)
+            status = FILEREADONLY;
+        else if (dirty == true)
+            desc->dirty = true;
     }
-    else bufTable[frameNo].pinCnt--;
-    return OK;
+    pthread_mutex_unlock(part);
+    return status;
 }
 
-const Status BufMgr::flushFile(const File* file) 
+
+// Clear the dirty bit of a latched frame that is about to be written
+// out and return its old value. unPinPage sets the bit under the
+// latch of the frame's partition, so the bit is cleared under it as
+// well; a page changed while it is being written is dirty again.
+
+bool BufMgr::takeDirty(BufDesc* desc)
 {
-  Status status;
+    pthread_mutex_t* part = hashTable->latch(desc->file, desc->pageNo);
+    pthread_mutex_lock(part);
+    bool dirty = desc->dirty;
+    desc->dirty = false;
+    pthread_mutex_unlock(part);
+    return dirty;
+}
+
+// qsort comparison routine ordering frame descriptors by file
+// and then by page number within the file
+
+int BufMgr::descCmp(const void* p1, const void* p2)
+{
+  const BufDesc* d1 = *(const BufDesc**)p1;
+  const BufDesc* d2 = *(const BufDesc**)p2;
+
+  if (d1->file != d2->file)
+    return d1->file < d2->file ? -1 : 1;
+  return d1->pageNo - d2->pageNo;
+}
+
+
+// qsort comparison routine ordering frame descriptors by frame
+
+int BufMgr::frameCmp(const void* p1, const void* p2)
+{
+  const BufDesc* d1 = *(const BufDesc**)p1;
+  const BufDesc* d2 = *(const BufDesc**)p2;
+
+  return d1->frameNo - d2->frameNo;
+}
 
-  for (int i = 0; i < numBufs; i++) {
-    BufDesc* tmpbuf = &(bufTable[i]);
-    if (tmpbuf->valid == true && tmpbuf->file == file) {
 
-      if (tmpbuf->pinCnt > 0)
-	  return PAGEPINNED;
+// Write the frames in descs[], whose dirty bits have been taken by
+// takeDirty, back to disk. The frames are sorted by (file, pageNo)
+// and every run of consecutive page numbers of one file is handed to
+// File::writePages, so it costs one system call instead of one per
+// page. Frames that could not be written are marked dirty again.
+
+const Status BufMgr::writeDirty(BufDesc* descs[], const int count)
+{
+  Status status = OK;
+
+  qsort(descs, count, sizeof(BufDesc*), descCmp);
+
+  int first = 0;
+  while (first < count)
+  {
+      // extend the run as long as page numbers are consecutive
+      int last = first;
+      runPages[0] = framePage(descs[first]->frameNo);
+      while (last + 1 < count &&
+             descs[last + 1]->file == descs[first]->file &&
+             descs[last + 1]->pageNo == descs[last]->pageNo + 1)
+      {
+          last++;
+          runPages[last - first] = framePage(descs[last]->frameNo);
+      }
 
-      if (tmpbuf->dirty == true) {
 #ifdef DEBUGBUF
-	cout << "flushing page " << tmpbuf->pageNo
-             << " from frame " << i << endl;
+      cout << "flushing pages " << descs[first]->pageNo << ".."
+           << descs[last]->pageNo << endl;
 #endif
-	if ((status = tmpbuf->file->writePage(tmpbuf->pageNo,
-					      &(bufPool[i]))) != OK)
-	  return status;
 
-	tmpbuf->dirty = false;
+      long long start = AsyncIO::clock();
+      Status runStatus = descs[first]->file->writePages(descs[first]->pageNo,
+                                                        last - first + 1,
+                                                        runPages);
+      addLatency(bufStats.writeLatency, AsyncIO::clock() - start);
+      if (runStatus == OK)
+          addStat(bufStats.diskwrites, last - first + 1);
+      else
+      {
+          for (int i = first; i <= last; i++)
+              descs[i]->dirty = true;
+          status = runStatus;
       }
 
+      first = last + 1;
+  }
+
+  return status;
+}
+
+
+// Write out the dirty pages of a file and take all its pages out of
+// the pool. Only the frames on the file's list are visited, in frame
+// order as the latching rules require; a frame that has given up its
+// page by the time it is latched is skipped.
+
+const Status BufMgr::flushFile(const File* file) 
+{
+  Status status = OK;
+
+  pthread_mutex_lock(&flushLatch);
+
+  // collect the frames of the file
+
+  pthread_mutex_t* list = listLatch(file);
+  int count = 0;
+  pthread_mutex_lock(list);
+  for (int i = file->bufFrames; i >= 0; i = frameDesc(i)->fileNext)
+    flushList[count++] = frameDesc(i);
+  pthread_mutex_unlock(list);
+  qsort(flushList, count, sizeof(BufDesc*), frameCmp);
+
+  // latch them, refusing to flush if any page of the file is still
+  // pinned
+
+  int latched = 0;
+  for (int i = 0; i < count && status == OK; i++) {
+    BufDesc* tmpbuf = flushList[i];
+    pthread_mutex_lock(&tmpbuf->latch);
+    if (tmpbuf->file != file) {
+      pthread_mutex_unlock(&tmpbuf->latch);
+      continue;
+    }
+    latchList[latched++] = tmpbuf;
+    if (tmpbuf->io && (status = finishIO(tmpbuf->frameNo)) != OK)
+      break;
+    if (tmpbuf->valid == false)
+      status = BADBUFFER;
+    else if (tmpbuf->pins() > 0)
+      status = PAGEPINNED;
+  }
+
+  // write out its dirty pages and take them out of the pool
+
+  if (status == OK) {
+    count = 0;
+    for (int i = 0; i < latched; i++)
+      if (takeDirty(latchList[i]))
+	flushList[count++] = latchList[i];
+    status = writeDirty(flushList, count);
+  }
+
+  if (status == OK) {
+    for (int i = 0; i < latched; i++) {
+      BufDesc* tmpbuf = latchList[i];
+      pthread_mutex_t* part = hashTable->latch(file, tmpbuf->pageNo);
+
+      pthread_mutex_lock(part);
       hashTable->remove(file,tmpbuf->pageNo);
+      pthread_mutex_unlock(part);
+      replacer->dropped(tmpbuf->frameNo);
+      unlinkFrame(tmpbuf);
 
       tmpbuf->file = NULL;
       tmpbuf->pageNo = -1;
       tmpbuf->valid = false;
     }
+  }
+
+  for (int i = 0; i < latched; i++)
+    pthread_mutex_unlock(&latchList[i]->latch);
+  pthread_mutex_unlock(&flushLatch);
+
+  return status;
+}
+
+
+// Write all dirty pages in the buffer pool back to disk, batched
+// across files and in (file, page) order; the pages stay in the
+// pool. With sync set, one DB::syncFiles barrier then makes these
+// and all earlier writes durable.
+
+const Status BufMgr::flushAll(const bool sync)
+{
+  Status status = OK;
+
+  pthread_mutex_lock(&flushLatch);
+
+  int latched = 0;
+  for (int i = 0; i < numBufs; i++) {
+    BufDesc* tmpbuf = frameDesc(i);
+    pthread_mutex_lock(&tmpbuf->latch);
+    if (tmpbuf->io && (status = finishIO(i)) != OK) {
+      pthread_mutex_unlock(&tmpbuf->latch);
+      break;
+    }
+    if (tmpbuf->valid == true && tmpbuf->dirty == true)
+      latchList[latched++] = tmpbuf;
+    else
+      pthread_mutex_unlock(&tmpbuf->latch);
+  }
+
+  if (status == OK) {
+    int count = 0;
+    for (int i = 0; i < latched; i++)
+      if (takeDirty(latchList[i]))
+	flushList[count++] = latchList[i];
+    status = writeDirty(flushList, count);
+  }
+
+  for (int i = 0; i < latched; i++)
+    pthread_mutex_unlock(&latchList[i]->latch);
+  pthread_mutex_unlock(&flushLatch);
+
+  if (status != OK)
+    return status;
+  return sync ? DB::syncFiles() : OK;
+}
+
+
+// time on the monotonic clock ms milliseconds from now
+
+static struct timespec clockIn(const long ms)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+static bool clockPast(const struct timespec & ts)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > ts.tv_sec
+        || (now.tv_sec == ts.tv_sec && now.tv_nsec >= ts.tv_nsec);
+}
+
 
-    else if (tmpbuf->valid == false && tmpbuf->file == file)
-      return BADBUFFER;
+// Write all dirty pages in the buffer pool back to disk like
+// flushAll(true), but CHECKPOINTBATCH frames at a time, so queries
+// are only kept from the frames of one batch, and pausing between
+// batches to write at most rate pages a second. Pages dirtied
+// behind the checkpoint are left for the next one. A checkpoint
+// gives up when the background writer is being stopped.
+
+const Status BufMgr::checkpoint(const int rate)
+{
+  Status status = OK;
+  struct timespec start = clockIn(0);
+  long written = 0;
+
+  for (int i = 0; i < numBufs && status == OK; ) {
+    pthread_mutex_lock(&flushLatch);
+    int count = 0;
+    for (; i < numBufs && count < CHECKPOINTBATCH; i++) {
+      BufDesc* tmpbuf = frameDesc(i);
+      pthread_mutex_lock(&tmpbuf->latch);
+      if (tmpbuf->io && (status = finishIO(i)) != OK) {
+	pthread_mutex_unlock(&tmpbuf->latch);
+	break;
+      }
+      if (tmpbuf->valid == true && takeDirty(tmpbuf))
+	flushList[count++] = tmpbuf;
+      else
+	pthread_mutex_unlock(&tmpbuf->latch);
+    }
+
+    Status writeStatus = writeDirty(flushList, count);
+    if (status == OK)
+      status = writeStatus;
+    for (int j = 0; j < count; j++)
+      pthread_mutex_unlock(&flushList[j]->latch);
+    pthread_mutex_unlock(&flushLatch);
+
+    if (__atomic_load_n(&writerStop, __ATOMIC_ACQUIRE))
+      return status;
+
+    // stay below rate pages a second since the start
+    written += count;
+    if (rate > 0 && count > 0) {
+      struct timespec due = start;
+      long ms = written * 1000 / rate;
+      due.tv_sec += ms / 1000;
+      due.tv_nsec += (ms % 1000) * 1000000;
+      if (due.tv_nsec >= 1000000000) {
+	due.tv_sec++;
+	due.tv_nsec -= 1000000000;
+      }
+      pthread_mutex_lock(&writerLock);
+      while (!writerStop
+	     && pthread_cond_timedwait(&writerWake, &writerLock, &due)
+	     != ETIMEDOUT)
+	;
+      pthread_mutex_unlock(&writerLock);
+    }
   }
-  
+
+  if (status == OK && (status = DB::syncFiles()) == OK)
+    addStat(bufStats.checkpoints);
+  return status;
+}
+
+
+// Start the background writer thread with the given settings.
+
+const Status BufMgr::startWriter(const WriterConfig & config)
+{
+  if (__atomic_load_n(&writerRunning, __ATOMIC_ACQUIRE))
+    return WRITERRUNNING;
+  writerConfig = config;
+  __atomic_store_n(&writerKicked, false, __ATOMIC_RELEASE);
+  if (pthread_create(&writer, NULL, writerMain, this) != 0)
+    return UNIXERR;
+  __atomic_store_n(&writerRunning, true, __ATOMIC_RELEASE);
   return OK;
 }
 
 
+void BufMgr::stopWriter()
+{
+  if (!__atomic_load_n(&writerRunning, __ATOMIC_ACQUIRE))
+    return;
+  pthread_mutex_lock(&writerLock);
+  __atomic_store_n(&writerStop, true, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&writerWake);
+  pthread_mutex_unlock(&writerLock);
+  pthread_join(writer, NULL);
+  __atomic_store_n(&writerRunning, false, __ATOMIC_RELEASE);
+  __atomic_store_n(&writerStop, false, __ATOMIC_RELEASE);
+}
+
+
+void* BufMgr::writerMain(void* arg)
+{
+  ((BufMgr*)arg)->runWriter();
+  return NULL;
+}
+
+
+// Main loop of the background writer: a cleaning round every delay
+// ms or when kicked, and a checkpoint when one is due.
+
+void BufMgr::runWriter()
+{
+  const WriterConfig & config = writerConfig;
+  struct timespec nextCheckpoint = clockIn(config.checkpointSecs * 1000L);
+
+  pthread_mutex_lock(&writerLock);
+  while (!writerStop) {
+    if (!writerKicked) {
+      struct timespec wake = clockIn(config.delay > 0 ? config.delay : 1);
+      pthread_cond_timedwait(&writerWake, &writerLock, &wake);
+    }
+    __atomic_store_n(&writerKicked, false, __ATOMIC_RELEASE);
+    if (writerStop)
+      break;
+    pthread_mutex_unlock(&writerLock);
+
+    if (config.maxPages > 0)
+      cleanAhead();
+    if (config.checkpointSecs > 0 && clockPast(nextCheckpoint)) {
+      (void)checkpoint(config.checkpointRate);
+      nextCheckpoint = clockIn(config.checkpointSecs * 1000L);
+    }
+
+    pthread_mutex_lock(&writerLock);
+  }
+  pthread_mutex_unlock(&writerLock);
+}
+
+
+// Wake the background writer, if there is one, for a cleaning round.
+
+void BufMgr::kickWriter()
+{
+  if (!__atomic_load_n(&writerRunning, __ATOMIC_ACQUIRE)
+      || __atomic_load_n(&writerKicked, __ATOMIC_ACQUIRE))
+    return;
+  pthread_mutex_lock(&writerLock);
+  __atomic_store_n(&writerKicked, true, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&writerWake);
+  pthread_mutex_unlock(&writerLock);
+}
+
+
+// A cleaning round: walk the frames in the order the replacement
+// policy will offer them and start writing out the dirty, unpinned
+// ones until cleanAhead frames are clean or being cleaned, or
+// maxPages writes have been started. The writes are started in
+// (file, page) order and the frames unlatched at once, so a query
+// that wants one of them only has to wait for its write to finish.
+// Frames latched by others are passed over, and the round is
+// skipped if a flush is going on, since that writes the pages
+// anyway.
+
+void BufMgr::cleanAhead()
+{
+  const WriterConfig & config = writerConfig;
+  if (pthread_mutex_trylock(&flushLatch) != 0)
+    return;
+
+  ReplCursor cursor;
+  int frameNo, latched = 0, clean = 0;
+  while (latched < config.maxPages && clean + latched < config.cleanAhead
+         && (frameNo = replacer->upcoming(cursor)) >= 0)
+  {
+    BufDesc* desc = frameDesc(frameNo);
+    if (pthread_mutex_trylock(&desc->latch) != 0)
+      continue;
+    bool dirty = false;
+    if (desc->valid && !desc->io)
+    {
+      pthread_mutex_t* part = hashTable->latch(desc->file, desc->pageNo);
+      pthread_mutex_lock(part);
+      dirty = desc->dirty && desc->pins() == 0;
+      pthread_mutex_unlock(part);
+    }
+    if (dirty)
+      latchList[latched++] = desc;
+    else
+    {
+      if (desc->pins() == 0)
+        clean++;
+      pthread_mutex_unlock(&desc->latch);
+    }
+  }
+
+  qsort(latchList, latched, sizeof(BufDesc*), descCmp);
+  for (int i = 0; i < latched; i++)
+  {
+    BufDesc* desc = latchList[i];
+    pthread_mutex_t* part = hashTable->latch(desc->file, desc->pageNo);
+    pthread_mutex_lock(part);
+    if (desc->dirty && desc->pins() == 0 && startWrite(desc) == OK)
+      addStat(bufStats.bgwrites);
+    pthread_mutex_unlock(part);
+    pthread_mutex_unlock(&desc->latch);
+  }
+  pthread_mutex_unlock(&flushLatch);
+}
+
 
 const Status BufMgr::disposePage(File* file, const int pageNo) 
 {
     // see if it is in the buffer pool
-    Status status = OK;
+    pthread_mutex_t* part = hashTable->latch(file, pageNo);
     int frameNo = 0;
-    status = hashTable->lookup(file, pageNo, frameNo);
+    pthread_mutex_lock(part);
+    Status status = hashTable->lookup(file, pageNo, frameNo);
+    pthread_mutex_unlock(part);
+
     if (status == OK)
     {
-        // clear the page
-        bufTable[frameNo].Clear();
+        // clear the page once any transfer of it is over, unless the
+        // frame has been given to another page in the meantime
+        BufDesc* desc = frameDesc(frameNo);
+        pthread_mutex_lock(&desc->latch);
+        if (desc->io)
+            (void)finishIO(frameNo);
+        pthread_mutex_lock(part);
+        if (desc->file == file && desc->pageNo == pageNo)
+        {
+            hashTable->remove(file, pageNo);
+            replacer->dropped(frameNo);
+            unlinkFrame(desc);
+            desc->Clear();
+        }
+        pthread_mutex_unlock(part);
+        pthread_mutex_unlock(&desc->latch);
     }
-    status = hashTable->remove(file, pageNo);
 
     // deallocate it in the file
     return file->disposePage(pageNo);
 }
 
 
-const Status BufMgr::allocPage(File* file, int& pageNo, Page*& page) 
+const Status BufMgr::allocPage(File* file, int& pageNo, Page*& page,
+                               BufStrategy* strategy) 
 {
     int frameNo;
 
@@ -260,31 +1437,287 @@ const Status BufMgr::allocPage(File* file, int& pageNo, Page*& page)
     if (status != OK)  return status; 
 
     // alloc a new frame
-     status = allocBuf(frameNo);
-     if (status != OK) return status;
+    status = allocBuf(frameNo, strategy);
+    if (status != OK) return status;
+    BufDesc* desc = frameDesc(frameNo);
 
-     // set up the entry properly
-     bufTable[frameNo].Set(file, pageNo);
-     page = &bufPool[frameNo];
+    // set up the entry properly and insert it in the hash table
+    pthread_mutex_t* part = hashTable->latch(file, pageNo);
+    pthread_mutex_lock(part);
+    desc->Set(file, pageNo);
+    status = hashTable->insert(file, pageNo, frameNo);
+    if (status == OK)
+        replacer->loaded(frameNo, file, pageNo,
+                         !strategy || strategy->access != NOCACHE);
+    pthread_mutex_unlock(part);
+    if (status != OK) desc->Clear();
+    else
+    {
+        linkFrame(desc);
+        if (strategy) ringAdd(strategy, frameNo, file, pageNo);
+    }
+    pthread_mutex_unlock(&desc->latch);
+    if (status != OK) return status;
 
-     // insert in thehash table
-     status = hashTable->insert(file, pageNo, frameNo);
-     if (status != OK) { return status; }
-     // cout << "allocated page " << pageNo <<  " to file " << file << "frame is: " << frameNo  << endl;
+    page = framePage(frameNo);
+    // cout << "allocated page " << pageNo <<  " to file " << file
+    //      << "frame is: " << frameNo  << endl;
     return OK;
 }
 
 
+// Save the list of pages in the pool to listName, one line of file
+// name and page number per page, grouped by file and in page order
+// within a file, for loadPool to bring them back after a restart.
+// The list is written to a temporary file first and renamed, so an
+// interrupted save leaves the previous list intact.
+
+const Status BufMgr::dumpPool(const string & listName)
+{
+  string tmpName = listName + ".tmp";
+  FILE* fp = fopen(tmpName.c_str(), "w");
+  if (!fp)
+    return UNIXERR;
+
+  pthread_mutex_lock(&flushLatch);
+  int latched = 0;
+  for (int i = 0; i < numBufs; i++) {
+    BufDesc* tmpbuf = frameDesc(i);
+    pthread_mutex_lock(&tmpbuf->latch);
+    if (tmpbuf->valid == true && tmpbuf->file)
+      latchList[latched++] = tmpbuf;
+    else
+      pthread_mutex_unlock(&tmpbuf->latch);
+  }
+  qsort(latchList, latched, sizeof(BufDesc*), descCmp);
+
+  for (int i = 0; i < latched; i++)
+    fprintf(fp, "%s %d\n", latchList[i]->file->fileName.c_str(),
+	    latchList[i]->pageNo);
+
+  for (int i = 0; i < latched; i++)
+    pthread_mutex_unlock(&latchList[i]->latch);
+  pthread_mutex_unlock(&flushLatch);
+
+  if (fclose(fp) != 0 || rename(tmpName.c_str(), listName.c_str()) < 0) {
+    (void)unlink(tmpName.c_str());
+    return UNIXERR;
+  }
+  return OK;
+}
+
+
+// Read the pages of a list saved by dumpPool back in, file by file,
+// opening the files through db. Pages of files that are open are read
+// into the pool, up to as many as it has frames, with one vectored read
+// per run of nearby pages; the pool drops the pages of a file once it
+// is closed, so the pages of other files are only read ahead into the
+// OS cache. Files and pages that no longer exist are skipped, as is a
+// missing list.
+
+const Status BufMgr::loadPool(DB & db, const string & listName)
+{
+  FILE* fp = fopen(listName.c_str(), "r");
+  if (!fp)
+    return errno == ENOENT ? OK : UNIXERR;
+
+  void* scratch;
+  if (posix_memalign(&scratch, IOALIGN, PAGESIZE) != 0) {
+    fclose(fp);
+    return UNIXERR;
+  }
+
+  Status status = OK;
+  char name[256], fileName[256];
+  int pageNo;
+  int count = 0, size = 1024;
+  int* pageNos = new int[size];
+  int loaded = 0;
+
+  fileName[0] = '\0';
+  for (;;) {
+    bool more = fscanf(fp, "%255s %d", name, &pageNo) == 2;
+    if (count > 0 && (!more || strcmp(name, fileName) != 0)) {
+      status = loadFile(db, fileName, pageNos, count, (Page*)scratch,
+			loaded);
+      count = 0;
+    }
+    if (!more || status != OK)
+      break;
+    if (count == size) {
+      int* larger = new int[2 * size];
+      memcpy(larger, pageNos, size * sizeof(int));
+      delete [] pageNos;
+      pageNos = larger;
+      size *= 2;
+    }
+    strcpy(fileName, name);
+    pageNos[count++] = pageNo;
+  }
+
+  delete [] pageNos;
+  free(scratch);
+  fclose(fp);
+  return status;
+}
+
+
+// Bring back the listed pages of one file, given in page order;
+// loaded counts the pages read into the pool so far. A run spans
+// listed pages up to LOADGAP apart and at most LOADRUN pages; the
+// pages in between are read into scratch and discarded.
+
+const Status BufMgr::loadFile(DB & db, const string & fileName,
+                              const int pageNos[], const int count,
+                              Page* scratch, int & loaded)
+{
+  File* file;
+  if (db.openFile(fileName, file) != OK)
+    return OK;                          // the file is gone
+  bool open = file->openCnt > 1;        // pages can stay in the pool
+  int runMax = numBufs / 4 < LOADRUN ? numBufs / 4 : LOADRUN;
+  if (runMax < 1)
+    runMax = 1;
+
+  Status status = OK;
+  for (int i = 0; i < count && status == OK; ) {
+    if (!file->isAllocated(pageNos[i])) {
+      i++;
+      continue;
+    }
+    int n = 1;
+    while (i + n < count && n < runMax
+	   && pageNos[i + n] > pageNos[i + n - 1]
+	   && pageNos[i + n] - pageNos[i + n - 1] <= LOADGAP + 1
+	   && pageNos[i + n] - pageNos[i] < LOADRUN
+	   && file->isAllocated(pageNos[i + n]))
+      n++;
+
+    if (!open || file->isMapped()) {
+      if (!file->isDirect())
+	status = file->advise(pageNos[i], pageNos[i + n - 1] - pageNos[i] + 1,
+			      WILLNEED);
+    }
+    else {
+      if (n > numBufs - loaded)
+	n = numBufs - loaded;
+      if (n <= 0)
+	break;
+      int read;
+      status = loadRun(file, pageNos + i, n, scratch, read);
+      loaded += read;
+    }
+    i += n;
+  }
+
+  // a full pool ends the load quietly
+  if (status == BUFFEREXCEEDED)
+    status = OK;
+  Status closeStatus = db.closeFile(file);
+  return status != OK ? status : closeStatus;
+}
+
+
+// Read the count listed pages of file, which lie within LOADRUN
+// pages of each other, into free frames with one vectored read
+// spanning them all. Pages in the pool already are read into
+// scratch, as are unlisted ones in between; read is set to the # of
+// pages read into frames. Until the read completes the frames stay
+// latched, so threads that find the pages wait for them as for any
+// page being read.
+
+const Status BufMgr::loadRun(File* file, const int pageNos[],
+                             const int count, Page* scratch, int & read)
+{
+  BufDesc* descs[LOADRUN];
+  Page* pages[LOADRUN];
+  int first = pageNos[0];
+  int span = 0;                         // # of pages up to last frame
+  Status status = OK;
+
+  for (int i = 0; i < LOADRUN; i++)
+    pages[i] = scratch;
+
+  read = 0;
+  for (int i = 0; i < count; i++) {
+    int pageNo = pageNos[i];
+    pthread_mutex_t* part = hashTable->latch(file, pageNo);
+    int frameNo;
+
+    pthread_mutex_lock(part);
+    bool present = hashTable->lookup(file, pageNo, frameNo) == OK;
+    pthread_mutex_unlock(part);
+    if (present)
+      continue;
+    if ((status = allocBuf(frameNo)) != OK)
+      break;
+    BufDesc* desc = frameDesc(frameNo);
+
+    int otherFrame;
+    pthread_mutex_lock(part);
+    if (hashTable->lookup(file, pageNo, otherFrame) == OK) {
+      pthread_mutex_unlock(part);
+      pthread_mutex_unlock(&desc->latch);
+      continue;
+    }
+    desc->Set(file, pageNo);
+    desc->loading = true;
+    status = hashTable->insert(file, pageNo, frameNo);
+    if (status == OK)
+      replacer->loaded(frameNo, file, pageNo, true);
+    pthread_mutex_unlock(part);
+    if (status != OK) {
+      desc->Clear();
+      pthread_mutex_unlock(&desc->latch);
+      break;
+    }
+    linkFrame(desc);
+    descs[read++] = desc;
+    pages[pageNo - first] = framePage(frameNo);
+    span = pageNo - first + 1;
+  }
+
+  Status readStatus = OK;
+  if (read > 0) {
+    long long start = AsyncIO::clock();
+    addStat(bufStats.diskreads, read);
+    readStatus = file->readPages(first, span, pages);
+    addLatency(bufStats.readLatency, AsyncIO::clock() - start);
+  }
+
+  for (int i = 0; i < read; i++) {
+    BufDesc* desc = descs[i];
+    if (readStatus != OK) {
+      pthread_mutex_t* part = hashTable->latch(file, desc->pageNo);
+      pthread_mutex_lock(part);
+      hashTable->remove(file, desc->pageNo);
+      pthread_mutex_unlock(part);
+      replacer->dropped(desc->frameNo);
+      unlinkFrame(desc);
+      desc->file = NULL;
+      desc->pageNo = -1;
+      desc->valid = false;
+    }
+    desc->unpin();
+    __atomic_store_n(&desc->loading, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&desc->latch);
+  }
+  if (readStatus != OK)
+    read = 0;
+  return status != OK ? status : readStatus;
+}
+
+
 void BufMgr::printSelf(void) 
 {
     BufDesc* tmpbuf;
-  
+
     cout << endl << "Print buffer...\n";
     for (int i=0; i<numBufs; i++) {
-        tmpbuf = &(bufTable[i]);
-        cout << i << "\t" << (char*)(&bufPool[i]) 
+        tmpbuf = frameDesc(i);
+        cout << i << "\t" << (char*)(framePage(i)) 
              << "\tpinCnt: " << tmpbuf->pinCnt;
-    
+
         if (tmpbuf->valid == true)
             cout << "\tvalid\n";
         cout << endl;
@@ -1,31 +1,58 @@
 #ifndef BUF_H
 #define BUF_H
 
+#include <pthread.h>
 #include "db.h"
+#include "page.h"
+#include "replace.h"
 // define if debug output wanted
 //#define DEBUGBUF
 
 // declarations for buffer pool hash table
-struct hashBucket
+struct hashEntry
 {
-	File*	file;    // pointer a file object (more on this below)
+	const File*	file;    // pointer a file object, NULL if slot is free
 	int	pageNo;  // page number within a file
 	int	frameNo; // frame number of page in the buffer pool
-	hashBucket* 	next;	 // next node in the hash table
 };
 
 
-// hash table to keep track of pages in the buffer pool
+// # of partitions of the buffer pool hash table; each partition has
+// its own latch
+
+const int BUFLATCHES = 16;
+
+// hash table to keep track of pages in the buffer pool. Each
+// partition is an open addressing table with linear probing whose
+// slots are allocated once by the constructor, so inserting and
+// removing entries never allocates memory.
 class BufHashTbl
 {
 private:
-    int HTSIZE;
-    hashBucket**  ht; // actual hash table
-    int	 hash(const File* file, const int pageNo); // returns value between 0 and HTSIZE-1
+    int partSize;     // # of slots per partition, a power of 2
+    hashEntry*  ht;   // actual hash table, BUFLATCHES * partSize slots
+    pthread_mutex_t latches[BUFLATCHES]; // one per partition
+    static unsigned long long hash(const File* file, const int pageNo);
+    hashEntry* partition(const unsigned long long h) const
+    {
+	return ht + (size_t)((h >> 32) % BUFLATCHES) * partSize;
+    }
+    int slot(const unsigned long long h) const
+    {
+	return (int)(h & (partSize - 1));
+    }
 
 public:
-    BufHashTbl(const int htSize);  // constructor
+    BufHashTbl(const int entries);  // constructor, room for entries pages
     ~BufHashTbl(); // destructor
+
+    // latch of the partition holding (file,pageNo). When several
+    // threads share the table it must be held around insert, lookup
+    // and remove of the entry.
+  pthread_mutex_t* latch(const File* file, const int pageNo)
+  {
+    return &latches[(hash(file, pageNo) >> 32) % BUFLATCHES];
+  }
 	
     // insert entry into hash table mapping (file,pageNo) to frameNo;
     // returns 0 if OK, HASHTBLERROR if an error occurred
@@ -44,7 +71,13 @@ public:
 
 class BufMgr;  //forward declaration of BufMgr class 
 
-// class for maintaining information about buffer pool frames
+// class for maintaining information about buffer pool frames.
+// The latch is held by a thread that changes which page a frame
+// holds, reads a page into it or writes it out. pinCnt, loading
+// and io are also read by threads that do not hold the latch and are
+// accessed atomically. The frames holding pages of one file are
+// linked in a list starting at File::bufFrames, under the buffer
+// manager's latch for that file's list.
 class BufDesc {
     friend class BufMgr;
 private:
@@ -54,7 +87,31 @@ private:
   int   pinCnt; // number of times this page has been pinned
   bool 	dirty;	  // true if dirty;  false otherwise
   bool 	valid;   // true if page is valid
-  bool  refbit;	 // has this buffer frame been reference recently
+  bool  loading; // true while the page is being read in
+  bool  readAhead; // true if prefetched and not referenced since
+  bool  evictWrite; // true if written out to be replaced
+  Page* mapped;  // page in file mapping, NULL if page is in bufPool
+  IOHandle io;   // read or write of the frame in progress, or NULL
+  pthread_mutex_t latch; // protects the frame's contents and identity
+  int   fileNext; // neighbours on the list of frames holding pages of
+  int   filePrev; // the same file, -1 at the ends
+
+  void pin() {
+      __atomic_add_fetch(&pinCnt, 1, __ATOMIC_ACQ_REL);
+  }
+
+  bool unpin() {  // returns false if the frame was not pinned
+      int n = __atomic_load_n(&pinCnt, __ATOMIC_ACQUIRE);
+      while (n > 0)
+	  if (__atomic_compare_exchange_n(&pinCnt, &n, n - 1, false,
+					  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	      return true;
+      return false;
+  }
+
+  int pins() const {
+      return __atomic_load_n(&pinCnt, __ATOMIC_ACQUIRE);
+  }
 
   void Clear() {  // initialize buffer frame for a new user
     	pinCnt = 0;
@@ -62,6 +119,11 @@ private:
 	pageNo = -1;
     	dirty = false;
 	valid = false;
+	loading = false;
+	readAhead = false;
+	evictWrite = false;
+	mapped = NULL;
+	io = NULL;
   };
 
   void Set(File* filePtr, int pageNum) { 
@@ -70,7 +132,11 @@ private:
       pinCnt = 1;
       dirty = false;
       valid = true;
-      refbit = true;
+      loading = false;
+      readAhead = false;
+      evictWrite = false;
+      mapped = NULL;
+      io = NULL;
   }
 
   BufDesc() {
@@ -79,15 +145,83 @@ private:
 };
 
 
+// kinds of bulk access a BufStrategy is made for, and the # of
+// frames of their rings
+
+enum BufAccess { BULKREAD, BULKWRITE, NOCACHE };
+
+const int BULKREADRING = 32;
+const int BULKWRITERING = 16;
+const int NOCACHERING = 4;
+
+// A buffer access strategy keeps the pages that a bulk operation
+// reads in or allocates in a small ring of frames, which are reused
+// in turn instead of taking frames from the rest of the pool, so a
+// large scan or load does not push out the pages other queries use.
+// Pages already in the pool are used where they are. Dirty frames
+// of the ring are written out in the background half a ring ahead
+// of their reuse. NOCACHE, for temporary files, also leaves its
+// pages unreferenced so the replacement policy takes them first
+// once the ring lets go of them. A strategy belongs to one scan and
+// is not shared between threads.
+
+class BufStrategy
+{
+    friend class BufMgr;
+public:
+  BufStrategy(const BufAccess access);
+  ~BufStrategy();
+
+private:
+  BufAccess access;
+  int   size;           // # of slots in the ring
+  int   next;           // slot to use next
+  int   current;        // slot being filled
+  int*  frames;         // frame of each slot, -1 if none
+  const File** files;   // page the ring put into each frame
+  int*  pageNos;
+};
+
+
+// # of buckets of a latency histogram. Bucket 0 counts transfers
+// that took less than 1 us, bucket i those that took 2^(i-1) us up
+// to 2^i us; the last bucket also counts all slower ones.
+
+const int LATENCYBUCKETS = 24;
+
+// buffer pool counters. A page request is an access; it is a miss if
+// the page had to be read in, and a hit if it was in the pool or being
+// read into it by a prefetch. The first hit on a prefetched page is
+// also a read-ahead hit. Hits are not counted on their own, to keep the
+// hit path to one shared counter per pool and per file. An eviction
+// takes a page out of a frame to make room for another, chosen by the
+// replacement policy or reused by a ring; a dirty eviction is one of a
+// page that the search for a frame or the ring had to write out, rather
+// than the background writer. A pin wait is a request that found its
+// page while another thread was reading or writing it. Latencies are
+// those of single transfers, or of runs of pages read or written with
+// one system call.
+
 struct BufStats
 {
-  int accesses;    // Total number of accesses to buffer pool
-  int diskreads;   // Number of pages read from disk (including allocs)
-  int diskwrites;  // Number of pages written back to disk
+  long long accesses;    // Total number of accesses to buffer pool
+  long long misses;      // Number of accesses that read the page in
+  long long readAheadHits; // Number of hits on prefetched pages
+  long long diskreads;   // Number of pages read from disk (including allocs)
+  long long diskwrites;  // Number of pages written back to disk
+  long long bgwrites;    // Number of those written by the background writer
+  long long checkpoints; // Number of checkpoints completed
+  long long evictions;   // Number of pages evicted
+  long long dirtyEvictions; // Number of those written out to be evicted
+  long long ringEvictions;  // Number of those evicted by a ring strategy
+  long long pinWaits;    // Number of accesses that waited for a transfer
+  long long pinWaitNanos; // Total time they waited, in ns
+  long long readLatency[LATENCYBUCKETS];  // histogram of read times
+  long long writeLatency[LATENCYBUCKETS]; // histogram of write times
 
   void clear()
     {
-      accesses = diskreads = diskwrites = 0;
+      memset(this, 0, sizeof(*this));
     }
       
   BufStats()
@@ -97,37 +231,192 @@ struct BufStats
 };
 
 
+// settings of the background writer. A cleaning round writes out
+// up to maxPages dirty pages among the frames the replacement policy
+// will offer next, until cleanAhead of them are clean; a round runs
+// every delay ms, and at once when a query finds a dirty frame to
+// replace. Every checkpointSecs seconds all dirty pages are written
+// out, at most checkpointRate pages a second, and the files synced.
+// A maxPages or checkpointSecs of 0 turns that part off; a
+// checkpointRate of 0 does not limit the rate.
+
+struct WriterConfig
+{
+  int delay;            // ms between cleaning rounds
+  int maxPages;         // max. # of pages a round writes
+  int cleanAhead;       // # of frames to keep clean ahead of the policy
+  int checkpointSecs;   // seconds between checkpoints
+  int checkpointRate;   // max. # of pages a checkpoint writes per second
+
+  WriterConfig() : delay(100), maxPages(64), cleanAhead(32),
+                   checkpointSecs(0), checkpointRate(0) {}
+};
+
+// # of frames a checkpoint latches and writes at a time
+
+const int CHECKPOINTBATCH = 32;
+
+
+// The frames of the pool are allocated in chunks of BUFCHUNKSIZE
+// bytes of pages, one huge page, so the pool can grow and shrink
+// without moving the pages in it and a large pool needs no single
+// huge allocation. Setting MINIREL_HUGEPAGES in the environment
+// backs the chunks with huge pages where the kernel has them.
+
+const int BUFCHUNKSIZE = 2 * 1024 * 1024;
+
+
+// file in the database directory listing the pages in the pool when
+// it was last saved; loadPool reads listed pages up to LOADGAP apart
+// with one read of at most LOADRUN pages
+
+#define POOLLISTNAME "bufpool.pages"
+
+const int LOADRUN = 64;
+const int LOADGAP = 8;
+
+
+// The buffer manager may be used by several threads at once. The
+// hash table is partitioned, each partition with its own latch, and
+// a page is pinned under the latch of its partition, so pinning a
+// page that is in the pool takes one short critical section. The
+// replacement policy, chosen when the buffer manager is created,
+// offers frames to replace in turn, and frames latched by other
+// threads are skipped instead of waited for. An optional background
+// writer thread keeps the frames to be replaced next clean, so
+// queries seldom wait for a page to be written out.
+//
+// resize changes the # of frames while pages are in the pool. It
+// must not run concurrently with other calls of the buffer manager;
+// pages stay where they are, so pages the caller has pinned remain
+// valid, but the pool only shrinks below frames that are unpinned.
+
 class BufMgr 
 {
 private:
-  unsigned int 	 clockHand;
   int   	 numBufs;    	// Number of pages in buffer pool
   BufHashTbl*    hashTable;  	// hash table mapping (File, page) to frame
-  BufDesc*	 bufTable;  	// vector of status info, 1 per page
+  ReplPolicy	 policy;	// replacement policy in use
+  Replacer*	 replacer;	// replacement policy
+  int		 chunkShift;	// log2 of # of frames per chunk
+  int		 numChunks;	// # of chunks allocated
+  BufDesc**	 descChunks;	// status info, 1 per frame, by chunk
+  Page**	 pageChunks;	// pages of the frames, by chunk
+  bool		 hugePages;	// back chunks with huge pages
   BufStats	 bufStats;	// buffer pool statistics
+  pthread_mutex_t flushLatch;	// serializes flushFile and flushAll
+  pthread_mutex_t listLatches[BUFLATCHES]; // protect the frame lists
+                                // of files, by hash of the File*
+  BufDesc**	 flushList;	// scratch list of frames to write out
+  BufDesc**	 latchList;	// scratch list of frames latched by a flush
+  const Page**	 runPages;	// scratch list of pages of one write run
+
+  // background writer; writerStop and writerKicked are protected by
+  // writerLock
+  WriterConfig	 writerConfig;
+  pthread_t	 writer;
+  bool		 writerRunning;	// true while the writer thread exists
+  bool		 writerStop;	// tells the writer to exit
+  bool		 writerKicked;	// a dirty frame was found to replace
+  pthread_mutex_t writerLock;
+  pthread_cond_t writerWake;	// signalled by kickWriter and stopWriter
 
-  const Status allocBuf(int & frame);   // allocate a free frame.  
+  const Status allocBuf(int & frame, BufStrategy* strategy = NULL);
+                                        // allocate a free frame.  
+  bool reuseRing(BufStrategy* strategy, int & frame); // next frame of ring
+  void writeBehind(BufStrategy* strategy, const int slot);
+  void ringAdd(BufStrategy* strategy, const int frame, const File* file,
+               const int pageNo);       // put new page in ring
+  const Status startWrite(BufDesc* desc); // write unpinned dirty frame
+  const Status waitFrame(const int frame); // wait until pinned frame is ready
+  const Status finishIO(const int frame); // wait for transfer of frame
+  bool takeDirty(BufDesc* desc);        // clear dirty bit before write
+  const Status writeDirty(BufDesc* descs[], const int count);
+                        // write frames in (file, page) order, coalesced
+  static int descCmp(const void* p1, const void* p2);
+  static int frameCmp(const void* p1, const void* p2);
   const void releaseBuf(int frame); // return unused frame to end of list
-  void advanceClock()
+  pthread_mutex_t* listLatch(const File* file)
   {
-	clockHand = (clockHand + 1) % numBufs;
+	return &listLatches[((unsigned long)file / sizeof(File)) % BUFLATCHES];
   }
+  void linkFrame(BufDesc* desc);    // put frame on its file's list
+  void unlinkFrame(BufDesc* desc);  // take it off before it loses page
+  static void* writerMain(void* arg); // background writer thread
+  void runWriter();
+  void kickWriter();                // start a cleaning round now
+  void cleanAhead();                // one cleaning round
+  static void addStat(long long & counter, const long long n = 1)
+  {                                 // bump a statistic
+	__atomic_add_fetch(&counter, n, __ATOMIC_RELAXED);
+  }
+  static void addLatency(long long histogram[], const long long nanos);
+                                    // count a transfer's time
+  void evicted(const BufDesc* desc, const bool ring);
+                                    // count the eviction of desc's page
 
+  BufDesc* frameDesc(const int frameNo) const  // status info of a frame
+  {
+	return &descChunks[frameNo >> chunkShift]
+	                  [frameNo & ((1 << chunkShift) - 1)];
+  }
 
-public:
-  Page*	         bufPool;   // actual buffer pool
+  Page* framePage(const int frameNo) const  // page held by a frame
+  {
+	return (Page*)((char*)pageChunks[frameNo >> chunkShift]
+		       + (size_t)(frameNo & ((1 << chunkShift) - 1)) * PAGESIZE);
+  }
 
-  BufMgr(const int bufs);
+  const Status addChunks(const int bufs); // allocate chunks for bufs frames
+  void freeChunks(const int chunks);    // release chunks beyond the first
+  const Status evictFrames(const int bufs); // empty frames bufs and above
+  void rebuild();                       // size hash table etc. to numBufs
+  const Status loadFile(DB & db, const string & fileName,
+                        const int pageNos[], const int count,
+                        Page* scratch, int & loaded);
+                        // bring back the listed pages of one file
+  const Status loadRun(File* file, const int pageNos[], const int count,
+                       Page* scratch, int & read); // read run into pool
+
+
+public:
+  BufMgr(const int bufs, const ReplPolicy policy = CLOCK);
   ~BufMgr();
 
-  const Status readPage(File* file, const int PageNo, Page*& page);
+  const Status resize(const int bufs);  // grow or shrink the pool
+  static const Status poolFrames(const char* size, int & frames);
+                        // # of frames in "N" frames or "N[K|M|G]" bytes
+  const Status dumpPool(const string & listName);
+                        // save the list of pages in the pool
+  const Status loadPool(DB & db, const string & listName);
+                        // read the pages of a saved list back in
+
+  const Status readPage(File* file, const int PageNo, Page*& page,
+                        BufStrategy* strategy = NULL);
+  const Status prefetchPage(File* file, const int PageNo,
+                            BufStrategy* strategy = NULL);
+                        // start reading a page ahead of need
   const Status unPinPage(File* file, const int PageNo, const bool dirty);
-  const Status allocPage(File* file, int& PageNo, Page*& page); 
+  const Status allocPage(File* file, int& PageNo, Page*& page,
+                         BufStrategy* strategy = NULL); 
                         // allocates a new, empty page 
   const Status flushFile(const File* file); // writing out all dirty pages of the file
+  const Status flushAll(const bool sync = false);
+                        // write out all dirty pages, then sync files
+  const Status checkpoint(const int rate = 0);
+                        // same, max. rate pages/sec, 0 for no limit
+  const Status startWriter(const WriterConfig & config);
+                        // start the background writer
+  void stopWriter();    // stop it, waiting for its round to end
   const Status disposePage(File* file, const int PageNo); // dispose of page in file
   void  printSelf();
 
+  int numFrames() const     // # of frames in the pool
+  {
+	return numBufs;
+  }
+  int ringSize(const BufStrategy* strategy) const; // # of frames of a ring
+
   const BufStats & getBufStats() const // get buffer pool usage
   {
 	return bufStats;
@@ -10,36 +10,51 @@
 
 // buffer pool hash table implementation
 
-int BufHashTbl::hash(const File* file, const int pageNo)
+// Mix the file pointer and page number into 64 bits (with the
+// finalizer of splitmix64), so that consecutive pages of a file and
+// pages of different files spread evenly over partitions and slots.
+// The high half picks the partition, the low bits the slot.
+
+unsigned long long BufHashTbl::hash(const File* file, const int pageNo)
 {
-  int tmp, value;
-  tmp = (int)(long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
+  unsigned long long h = (unsigned long long)(unsigned long)file;
+  h ^= (unsigned long long)(unsigned)pageNo * 0x9e3779b97f4a7c15ULL;
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
 }
 
 
-BufHashTbl::BufHashTbl(int htSize)
+// Each partition gets twice its share of the entries plus some
+// slack, which keeps probe sequences short and makes it unlikely
+// that one partition fills up, but never more slots than are needed
+// to hold all entries in one partition.
+
+BufHashTbl::BufHashTbl(int entries)
 {
-  HTSIZE = htSize;
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  int want = 2 * entries / BUFLATCHES + 32;
+  if (want > entries + 1)
+    want = entries + 1;
+  partSize = 1;
+  while (partSize < want)
+    partSize *= 2;
+
+  ht = new hashEntry [(size_t)BUFLATCHES * partSize];
+  for(int i=0; i < BUFLATCHES * partSize; i++)
+    ht[i].file = NULL;
+  for(int i=0; i < BUFLATCHES; i++)
+    pthread_mutex_init(&latches[i], NULL);
 }
 
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
-    }
-  }
   delete [] ht;
+  for(int i = 0; i < BUFLATCHES; i++)
+    pthread_mutex_destroy(&latches[i]);
 }
 
 
@@ -50,25 +65,25 @@ BufHashTbl::~BufHashTbl()
 
 Status BufHashTbl::insert(const File* file, const int pageNo, const int frameNo) {
 
-  int index = hash(file, pageNo);
-
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+  unsigned long long h = hash(file, pageNo);
+  hashEntry* part = partition(h);
+  int mask = partSize - 1;
+  int index = slot(h);
+
+  for (int probes = 0; probes < partSize; probes++) {
+    hashEntry* entry = &part[index];
+    if (!entry->file) {
+      entry->file = file;
+      entry->pageNo = pageNo;
+      entry->frameNo = frameNo;
+      return OK;
+    }
+    if (entry->file == file && entry->pageNo == pageNo)
       return HASHTBLERROR;
-    tmpBuc = tmpBuc->next;
+    index = (index + 1) & mask;
   }
 
-  tmpBuc = new hashBucket;
-  if (!tmpBuc)
-    return HASHTBLERROR;
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
-
-  return OK;
+  return HASHTBLERROR;    // partition is full
 }
 
 
@@ -80,15 +95,21 @@ Status BufHashTbl::insert(const File* file, const int pageNo, const int frameNo)
 
 Status BufHashTbl::lookup(const File* file, const int pageNo, int& frameNo) 
   {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+  unsigned long long h = hash(file, pageNo);
+  hashEntry* part = partition(h);
+  int mask = partSize - 1;
+  int index = slot(h);
+
+  for (int probes = 0; probes < partSize; probes++) {
+    hashEntry* entry = &part[index];
+    if (!entry->file)
+      break;
+    if (entry->file == file && entry->pageNo == pageNo)
     {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
+      frameNo = entry->frameNo; // return frameNo by reference
       return OK;
     }
-    tmpBuc = tmpBuc->next;
+    index = (index + 1) & mask;
   }
   return HASHNOTFOUND;
 }
@@ -97,27 +118,45 @@ Status BufHashTbl::lookup(const File* file, const int pageNo, int& frameNo)
 //-------------------------------------------------------------------
 // delete entry (file,pageNo) from hash table. REturn OK if page was
 // found.  Else return HASHTBLERROR
+//
+// Entries after the removed one in its probe sequence are shifted
+// back into the hole, so no tombstones are needed and lookups stop
+// at the first free slot.
 //-------------------------------------------------------------------
 
 Status BufHashTbl::remove(const File* file, const int pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = ht[index];
-
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      if (tmpBuc == ht[index]) 
-	ht[index] = tmpBuc->next;
-      else
-	prevBuc->next = tmpBuc->next;
-      delete tmpBuc;
-      return OK;
-    } else {
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+  unsigned long long h = hash(file, pageNo);
+  hashEntry* part = partition(h);
+  int mask = partSize - 1;
+  int hole = slot(h);
+  int probes;
+
+  for (probes = 0; probes < partSize; probes++) {
+    if (!part[hole].file)
+      return HASHTBLERROR;
+    if (part[hole].file == file && part[hole].pageNo == pageNo)
+      break;
+    hole = (hole + 1) & mask;
+  }
+  if (probes == partSize)
+    return HASHTBLERROR;
+
+  // an entry may move into the hole if the hole lies between the
+  // entry's home slot and the slot it is in
+  int index = hole;
+  for (probes = 1; probes < partSize; probes++) {
+    index = (index + 1) & mask;
+    hashEntry* entry = &part[index];
+    if (!entry->file)
+      break;
+    int home = slot(hash(entry->file, entry->pageNo));
+    if (((index - home) & mask) >= ((index - hole) & mask)) {
+      part[hole] = *entry;
+      hole = index;
     }
   }
+  part[hole].file = NULL;
 
-  return HASHTBLERROR;
+  return OK;
 }
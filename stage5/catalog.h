@@ -48,10 +48,12 @@ class RelCatalog : public HeapFile {
   // remove tuple from catalog
   const Status removeInfo(const string & relation);
 
-  // create a new relation
+  // create a new relation, whose pages are laid out as pageFlags
+  // says, FIXEDREC or FIXEDREC|PAX
   const Status createRel(const string & relation, 
 		   const int attrCnt, 
-		   const attrInfo attrList[]);
+		   const attrInfo attrList[],
+		   const int pageFlags = FIXEDREC);
 
   // destroy a relation
   const Status destroyRel(const string & relation);
@@ -115,7 +117,12 @@ class AttrCatalog : public HeapFile {
 extern RelCatalog  *relCat;
 extern AttrCatalog *attrCat;
 extern Error error;
-extern Status createHeapFile(const string filename);
+extern Status createHeapFile(const string filename,
+			     const int extentPages = DEFEXTENT,
+			     const int pageFlags = SLOTMAP,
+			     const int recLen = 0,
+			     const int colCnt = 0,
+			     const short colLen[] = NULL);
 extern Status destroyHeapFile(const string filename);
 
 #endif
@@ -3,7 +3,8 @@
 
 const Status RelCatalog::createRel(const string & relation, 
 				   const int attrCnt,
-				   const attrInfo attrList[])
+				   const attrInfo attrList[],
+				   const int pageFlags)
 {
   Status status;
   RelDesc rd;
@@ -11,6 +12,8 @@ const Status RelCatalog::createRel(const string & relation,
 
   if (relation.empty() || attrCnt < 1)
     return BADCATPARM;
+  if ((pageFlags & PAX) && attrCnt > MAXCOLUMNS)
+    return BADCATPARM;
 
   if (relation.length() >= sizeof rd.relName)
     return NAMETOOLONG;
@@ -36,7 +39,10 @@ const Status RelCatalog::createRel(const string & relation,
     }
   }
   
-  if (tupleWidth > PAGESIZE)            // should be more strict
+  // every record of a relation has the same width, so its pages use
+  // the fixed-length record format, or PAX, which stores the values of
+  // each attribute of a page together
+  if (tupleWidth > Page::maxRecLen(pageFlags | FIXEDREC))
     return ATTRTOOLONG;
 
   cout << "Creating relation " << relation << endl;
@@ -51,6 +57,7 @@ const Status RelCatalog::createRel(const string & relation,
   // insert information about attributes
 
   strcpy(ad.relName, relation.c_str());
+  short colLen[MAXCOLUMNS];
   int offset = 0;
   for(int i = 0; i < attrCnt; i++) {
     if (strlen(attrList[i].attrName) >= sizeof ad.attrName)
@@ -65,10 +72,13 @@ const Status RelCatalog::createRel(const string & relation,
       return status;
     }
     offset += ad.attrLen;
+    if (i < MAXCOLUMNS)
+      colLen[i] = ad.attrLen;
   }
 
   // now create the actual heapfile to hold the relation
-  status = createHeapFile (relation);
+  status = createHeapFile (relation, DEFEXTENT, pageFlags | FIXEDREC,
+			   tupleWidth, attrCnt, colLen);
   if (status != OK) return status;
   return OK;
 }
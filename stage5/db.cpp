@@ -3,7 +3,12 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <iostream>
+#include <new>
 #include <math.h>
 #include <stdio.h>
 #include "page.h"
@@ -13,10 +18,89 @@
 
 #define DBP(p)      (*(DBPage*)&p)
 
+// The allocation map is a bitmap with one bit per page; a set bit
+// means the page is in use. Pages are divided into groups of
+// MAPGROUP pages and the map for group g lives on the first page
+// of the group, after a reserved area of MAPHDR bytes. Page 0 is
+// thus both the DB header page and the map of the first group.
+// The map pages are read when the file is opened and written back
+// when it is closed, so allocating and disposing pages does no I/O.
+
+#define MAPHDR       64
+#define MAPGROUP     (((int)PAGESIZE - MAPHDR) * 8)
+#define MAPPAGE(g)   ((g) * MAPGROUP)
+#define MAPBITS(g)   ((unsigned char*)allocMap[g] + MAPHDR)
+
+// Pages are PAGESIZE bytes long, which sizeof(Page) need not be.
+// They are aligned on IOALIGN, so direct I/O can use them as is.
+
+static Page* newPage()
+{
+  void* page;
+  if (posix_memalign(&page, IOALIGN, PAGESIZE) != 0)
+    throw std::bad_alloc();
+  return (Page*)page;
+}
+
+static void deletePage(Page* page)
+{
+  free(page);
+}
+
+// Bump an I/O statistic; pages of a file may be read and written by
+// several threads at once.
+
+static void addStat(int & counter, const int n = 1)
+{
+  __atomic_add_fetch(&counter, n, __ATOMIC_RELAXED);
+}
+
+// The I/O engine shared by all files, started on first use.
+
+static AsyncIO* asyncIO = NULL;
+static pthread_mutex_t engineLock = PTHREAD_MUTEX_INITIALIZER;
+
+static AsyncIO* ioEngine()
+{
+  AsyncIO* engine = __atomic_load_n(&asyncIO, __ATOMIC_ACQUIRE);
+  if (!engine) {
+    pthread_mutex_lock(&engineLock);
+    if (!asyncIO)
+      __atomic_store_n(&asyncIO, new AsyncIO(AIODEPTH), __ATOMIC_RELEASE);
+    engine = asyncIO;
+    pthread_mutex_unlock(&engineLock);
+  }
+  return engine;
+}
+
+// files changed since they were last synced, linked by syncNext and
+// protected by syncLock, as pages of a file may be written by
+// several threads
+
+static File* unsyncedFiles = NULL;
+static pthread_mutex_t syncLock = PTHREAD_MUTEX_INITIALIZER;
+
+// DB::syncFiles writes back the headers and allocation maps of files
+// on the background writer's thread while queries go on, so changes
+// to a header or map, opening a file and closing or deleting it are
+// serialized with it by mapLock. It is taken after any buffer pool
+// latch and before syncLock.
+
+static pthread_mutex_t mapLock = PTHREAD_MUTEX_INITIALIZER;
+
+// max. number of pages moved by one preadv/pwritev call
+
+#ifdef IOV_MAX
+#define MAXIOVPAGES IOV_MAX
+#else
+#define MAXIOVPAGES 1024
+#endif
+
 // openfile hash table implementation
 OpenFileHashTbl::OpenFileHashTbl()
 {
-  HTSIZE = 113; // hack 
+  HTSIZE = 64;
+  numEntries = 0;
   // allocate an array of pointers to fleHashBuckets
   ht = new fileHashBucket* [HTSIZE];
   for(int i=0; i < HTSIZE; i++) ht[i] = NULL;
@@ -37,36 +121,70 @@ OpenFileHashTbl::~OpenFileHashTbl()
   delete [] ht;
 }
 
-int OpenFileHashTbl::hash(const string fileName)
+// FNV-1a hash of the file name. The name is hashed in place; the
+// bucket index is taken from the low bits.
+
+unsigned int OpenFileHashTbl::hash(const string & fileName)
 {
-   int i, value, len;
-   len =  (int) fileName.length();
-   value = 0;
-   for (i=0;i<len;i++) value = 31*value + (int) fileName[i];
+  unsigned int value = 2166136261u;
+  const char* p = fileName.data();
+  for (int i = (int)fileName.length(); i > 0; i--, p++)
+    value = (value ^ (unsigned char)*p) * 16777619u;
+  return value;
+}
 
-   value  = abs(value % HTSIZE);
-   return value;
+// double the number of buckets and rehash the entries using the
+// stored hash values
+
+void OpenFileHashTbl::grow()
+{
+  int newSize = 2 * HTSIZE;
+  fileHashBucket** newHt = new fileHashBucket* [newSize];
+  for (int i = 0; i < newSize; i++) newHt[i] = NULL;
+
+  for (int i = 0; i < HTSIZE; i++) {
+    while (ht[i]) {
+      fileHashBucket* tmpBuc = ht[i];
+      ht[i] = tmpBuc->next;
+      int index = tmpBuc->hashVal & (newSize - 1);
+      tmpBuc->next = newHt[index];
+      newHt[index] = tmpBuc;
+    }
+  }
+
+  delete [] ht;
+  ht = newHt;
+  HTSIZE = newSize;
 }
 
 // inserts fileName into hash table of open files
 // returns OK if insertion was successful, HASHTBLERROR if an error occurred
 //---------------------------------------------------------------
 
-Status OpenFileHashTbl::insert(const string fileName, File* file ) 
+Status OpenFileHashTbl::insert(const string & fileName, File* file ) 
 {
-  int index = hash(fileName);
+  unsigned int hashVal = hash(fileName);
+  int index = hashVal & (HTSIZE - 1);
   fileHashBucket* tmpBuc = ht[index];
   while (tmpBuc) {
-    if (tmpBuc->fname == fileName) return HASHTBLERROR;
+    if (tmpBuc->hashVal == hashVal && tmpBuc->fname == fileName)
+      return HASHTBLERROR;
     tmpBuc = tmpBuc->next;
   }
 
+  if (numEntries >= HTSIZE) {
+    grow();
+    index = hashVal & (HTSIZE - 1);
+  }
+
   tmpBuc = new fileHashBucket;
   if (!tmpBuc) return HASHTBLERROR;
   tmpBuc->fname = fileName;
   tmpBuc->file = file;
+  tmpBuc->hashVal = hashVal;
   tmpBuc->next = ht[index];
   ht[index] = tmpBuc;
+  numEntries++;
 
   return OK;
 }
@@ -78,12 +196,12 @@ Status OpenFileHashTbl::insert(const string fileName, File* file )
 // via the file
 //-------------------------------------------------------------------
 
-Status OpenFileHashTbl::find(const string fileName, File*& file)
+Status OpenFileHashTbl::find(const string & fileName, File*& file) const
 {
-  int index = hash(fileName);
-  fileHashBucket* tmpBuc = ht[index];
+  unsigned int hashVal = hash(fileName);
+  fileHashBucket* tmpBuc = ht[hashVal & (HTSIZE - 1)];
   while (tmpBuc) {
-    if (tmpBuc->fname == fileName) 
+    if (tmpBuc->hashVal == hashVal && tmpBuc->fname == fileName) 
     {
       file = tmpBuc->file;
       return OK;
@@ -100,19 +218,21 @@ Status OpenFileHashTbl::find(const string fileName, File*& file)
 // Else return HASHTBLERROR
 //-------------------------------------------------------------------
 
-Status OpenFileHashTbl::erase(const string fileName)
+Status OpenFileHashTbl::erase(const string & fileName)
 {
-  int index = hash(fileName);
+  unsigned int hashVal = hash(fileName);
+  int index = hashVal & (HTSIZE - 1);
   fileHashBucket* tmpBuc = ht[index];
   fileHashBucket* prevBuc = ht[index];
 
   while (tmpBuc) {
-    if (tmpBuc->fname == fileName)
+    if (tmpBuc->hashVal == hashVal && tmpBuc->fname == fileName)
     {
       if (tmpBuc == ht[index]) ht[index] = tmpBuc->next;
       else prevBuc->next = tmpBuc->next;
       tmpBuc->file = NULL;
       delete tmpBuc;
+      numEntries--;
       return OK;
     } 
     else {
@@ -124,6 +244,18 @@ Status OpenFileHashTbl::erase(const string fileName)
   return HASHTBLERROR;
 }
 
+
+//-------------------------------------------------------------------
+// append every file in the table to files
+//-------------------------------------------------------------------
+
+void OpenFileHashTbl::list(vector<File*> & files) const
+{
+  for (int i = 0; i < HTSIZE; i++)
+    for (fileHashBucket* tmpBuc = ht[i]; tmpBuc; tmpBuc = tmpBuc->next)
+      files.push_back(tmpBuc->file);
+}
+
 // Construct a File object which can operate on Unix files.
 
 File::File(const string & fname)
@@ -131,13 +263,25 @@ File::File(const string & fname)
   fileName = fname;
   openCnt = 0;
   unixFile = -1;
+  hdrDirty = false;
+  freeHint = 0;
+  mapBase = NULL;
+  mapPages = 0;
+  direct = false;
+  memAlign = 1;
+  lruPrev = lruNext = NULL;
+  unsynced = false;
+  syncNext = NULL;
+  bufFrames = -1;
 }
 
 // Deallocate a file object
 File::~File()
 {
-  if (openCnt == 0)
+  if (openCnt == 0) {
+    release();
     return;
+  }
 
   // This means that file must be closed down if open
   // and buffer pages flushed.
@@ -145,6 +289,8 @@ File::~File()
   openCnt = 1;
 
   Status status = close();
+  if (status == OK)
+    status = release();
   if (status != OK)
     {
       Error error;
@@ -152,7 +298,7 @@ File::~File()
     }
 }
 
-Status const File::create(const string & fileName)
+Status const File::create(const string & fileName, const int extentPages)
 {
   int file;
   if ((file = ::open(fileName.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0666)) < 0)
@@ -163,14 +309,18 @@ Status const File::create(const string & fileName)
 	return UNIXERR;
     }
 
-  // An empty file contains just a DB header page.
+  // An empty file contains just a DB header page, which also
+  // holds the allocation map of the first group.
 
-  Page header;
-  memset(&header, 0, sizeof header);
-  DBP(header).nextFree = -1;
+  char header[PAGESIZE];
+  memset(header, 0, PAGESIZE);
   DBP(header).firstPage = -1;
   DBP(header).numPages = 1;
-  if (write(file, (char*)&header, sizeof header) != sizeof header)
+  DBP(header).mapGroups = 1;
+  DBP(header).extentPages = extentPages;
+  DBP(header).pageSize = PAGESIZE;
+  ((unsigned char*)header)[MAPHDR] = 0x1;
+  if (write(file, header, PAGESIZE) != (int)PAGESIZE)
     return UNIXERR;
 
   if (::close(file) < 0)
@@ -190,25 +340,93 @@ const Status File::destroy(const string & fileName)
   return OK;
 }
 
-const Status File::open()
+const Status File::open(const AccessMode mode, const bool directIO)
 {
   // Open file -- it will be closed in closeFile().
 
   if (openCnt == 0)
     {
-      if ((unixFile = ::open(fileName.c_str(), O_RDWR)) < 0)
-	return UNIXERR;
+      // A file kept open by the descriptor cache of the DB still
+      // has its unix file and its header and allocation map.
+
+      if (unixFile < 0)
+	{
+	  if ((unixFile = ::open(fileName.c_str(), O_RDWR)) < 0)
+	    return UNIXERR;
+
+	  // Bring the header and allocation map into memory. They
+	  // stay cached until the unix file is closed.
+
+	  Status status;
+	  if ((status = readMap()) != OK)
+	    {
+	      ::close(unixFile);
+	      unixFile = -1;
+	      return status;
+	    }
+	}
+
+      setDirect(directIO);
+
+      // Map the file if asked to. The mapping covers the pages
+      // that exist now; since a mapped file cannot be written it
+      // never grows. If the file cannot be mapped it is simply
+      // accessed through read() and write().
+
+      if (mode == MAPPED)
+	{
+	  void* addr = mmap(NULL, (size_t)header.numPages * PAGESIZE,
+			    PROT_READ, MAP_SHARED, unixFile, 0);
+	  if (addr != MAP_FAILED)
+	    {
+	      mapBase = (Page*)addr;
+	      mapPages = header.numPages;
+	    }
+	}
 
       // Store file info in open files table.
 
       openCnt = 1;
     }
   else
-    openCnt++;
+    {
+      // A file that is mapped read-only may be opened again for
+      // reading, but not for writing. A request to map a file
+      // that is already open for writing gets the unmapped file.
+
+      if (mapBase && mode != MAPPED)
+	return FILEREADONLY;
+      openCnt++;
+    }
 
   return OK;
 }
 
+
+// Switch direct I/O on or off. It is only switched on if the
+// filesystem can do direct I/O at page granularity; otherwise the
+// file stays buffered.
+
+void File::setDirect(const bool on)
+{
+#ifdef O_DIRECT
+  if (on && !direct && canDirect()
+      && fcntl(unixFile, F_SETFL, fcntl(unixFile, F_GETFL) | O_DIRECT) == 0)
+    direct = true;
+  else if (!on && direct)
+    {
+      fcntl(unixFile, F_SETFL, fcntl(unixFile, F_GETFL) & ~O_DIRECT);
+      direct = false;
+    }
+#endif
+}
+
+
+// Close the file. When the open count goes to zero its pages are
+// flushed from the buffer pool and the header and allocation map
+// are written back, but the unix file stays open until release()
+// is called, so that the DB can cache it.
+
 const Status File::close()
 {
   if (openCnt <= 0)
@@ -216,67 +434,294 @@ const Status File::close()
 
   openCnt--;
 
-  // File actually closed only when open count goes to zero.
-
   if (openCnt == 0) {
 
     if (bufMgr)
       bufMgr->flushFile(this);
 
-    if (::close(unixFile) < 0)
+    if (mapBase) {
+      munmap((void*)mapBase, (size_t)mapPages * PAGESIZE);
+      mapBase = NULL;
+      mapPages = 0;
+    }
+
+    pthread_mutex_lock(&mapLock);
+    Status status = writeMap();
+    pthread_mutex_unlock(&mapLock);
+    return status;
+  }
+
+  return OK;
+}
+
+
+// Close the unix file of a closed file and drop the cached header
+// and allocation map.
+
+const Status File::release()
+{
+  if (unixFile < 0)
+    return OK;
+
+  setDirect(false);
+
+  // a file closed for good is synced now, as DB::syncFiles will not
+  // see it any more
+  Status status = OK;
+  if (unsynced) {
+    if (fdatasync(unixFile) < 0)
+      status = UNIXERR;
+    addStat(ioStats.syncs);
+    synced();
+  }
+
+  for (unsigned int g = 0; g < allocMap.size(); g++)
+    deletePage(allocMap[g]);
+  allocMap.clear();
+  mapDirty.clear();
+
+  int fd = unixFile;
+  unixFile = -1;
+  if (::close(fd) < 0)
+    return UNIXERR;
+
+  return status;
+}
+
+
+const Status File::readMap()
+{
+  Status status;
+
+  for (int g = 0; g == 0 || g < header.mapGroups; g++) {
+    Page* map = newPage();
+    if ((status = intread(MAPPAGE(g), map)) == OK && g == 0) {
+      header = DBP(*map);
+      if (header.pageSize != (int)PAGESIZE)
+	status = BADPAGESIZE;           // file of another database
+    }
+    if (status != OK) {
+      deletePage(map);
+      for (unsigned int i = 0; i < allocMap.size(); i++)
+	deletePage(allocMap[i]);
+      allocMap.clear();
+      mapDirty.clear();
+      return status;
+    }
+    allocMap.push_back(map);
+    mapDirty.push_back(false);
+  }
+  hdrDirty = false;
+
+  freeHint = 0;
+  return OK;
+}
+
+
+// Write the header page and any map pages that changed since the
+// file was opened.
+
+const Status File::writeMap()
+{
+  Status status;
+
+  if (hdrDirty) {
+    DBP(*allocMap[0]) = header;
+    mapDirty[0] = true;
+    hdrDirty = false;
+  }
+
+  for (unsigned int g = 0; g < allocMap.size(); g++) {
+    if (mapDirty[g]) {
+      if ((status = intwrite(MAPPAGE(g), allocMap[g])) != OK)
+	return status;
+      mapDirty[g] = false;
+    }
+  }
+
+  return OK;
+}
+
+
+bool File::isFree(const int pageNo) const
+{
+  if (pageNo % MAPGROUP == 0)
+    return false;                       // header or map page
+
+  unsigned int g = pageNo / MAPGROUP;
+  if (g >= allocMap.size())
+    return true;                        // beyond end of file
+
+  int bit = pageNo % MAPGROUP;
+  return !(MAPBITS(g)[bit / 8] & (1 << (bit % 8)));
+}
+
+
+// Check whether pageNo is a page handed out by allocatePage and not
+// disposed of since; the header and map pages are not.
+
+bool File::isAllocated(const int pageNo) const
+{
+  return pageNo >= 1 && pageNo < header.numPages
+    && pageNo % MAPGROUP != 0 && !isFree(pageNo);
+}
+
+
+void File::setInUse(const int pageNo, const bool inUse)
+{
+  int g = pageNo / MAPGROUP;
+  int bit = pageNo % MAPGROUP;
+  unsigned char* bits = MAPBITS(g);
+
+  if (inUse)
+    bits[bit / 8] |= (1 << (bit % 8));
+  else
+    bits[bit / 8] &= ~(1 << (bit % 8));
+  mapDirty[g] = true;
+  written();
+}
+
+
+// Append the map page of the next group to the file. The map
+// page marks itself as in use.
+
+const Status File::addGroup()
+{
+  int g = allocMap.size();
+  Page* map = newPage();
+  memset(map, 0, PAGESIZE);
+  allocMap.push_back(map);
+  mapDirty.push_back(true);
+  setInUse(MAPPAGE(g), true);
+
+  header.mapGroups++;
+  hdrDirty = true;
+  return extend(MAPPAGE(g));
+}
+
+
+// Make sure that the file is large enough to hold page pageNo.
+// The file grows to the next multiple of the extent size, and the
+// space is reserved with fallocate so the filesystem can lay the
+// extent out contiguously. The new pages read back as zeroes.
+
+const Status File::extend(const int pageNo)
+{
+  if (pageNo < header.numPages)
+    return OK;
+
+  int extent = header.extentPages;
+  int numPages = (pageNo / extent + 1) * extent;
+  off_t offset = (off_t)header.numPages * PAGESIZE;
+  off_t len = (off_t)(numPages - header.numPages) * PAGESIZE;
+
+#ifdef __linux__
+  if (fallocate(unixFile, 0, offset, len) < 0) {
+    // filesystem cannot preallocate; just set the new size
+    if (errno != EOPNOTSUPP
+	|| ftruncate(unixFile, offset + len) < 0)
       return UNIXERR;
   }
+#else
+  if (ftruncate(unixFile, offset + len) < 0)
+    return UNIXERR;
+#endif
+  addStat(ioStats.extends);
 
+  header.numPages = numPages;
+  hdrDirty = true;
+  written();
   return OK;
 }
 
 
-// Allocate a page either from a free list (list of pages which
-// were previously disposed of), or extend file if no free pages
-// are available.
+// Allocate a page. The lowest numbered free page is reused, or
+// the file is extended if no free pages are available.
 
 Status File::allocatePage(int& pageNo)
 {
-  Page header;
-  Status status;
+  return allocatePages(1, pageNo);
+}
 
-  if ((status = intread(0, &header)) != OK)
-    return status;
 
-  // If free list has pages on it, take one from there
-  // and adjust free list accordingly.
+Status File::allocatePages(const int count, int& firstPageNo)
+{
+  pthread_mutex_lock(&mapLock);
+  Status status = allocRun(count, firstPageNo);
+  pthread_mutex_unlock(&mapLock);
+  return status;
+}
 
-  if (DBP(header).nextFree != -1) {     // free list exists?
 
-    // Return first page on free list to the caller,
-    // adjust free list accordingly.
+// Allocate count physically contiguous pages and return the page
+// number of the first one. The map is searched first-fit; a run
+// that does not fit in the existing file extends it. Runs never
+// span a map page.
 
-    pageNo = DBP(header).nextFree;
-    Page firstFree;
-    if ((status = intread(pageNo, &firstFree)) != OK)
-      return status;
-    DBP(header).nextFree = DBP(firstFree).nextFree;
+Status File::allocRun(const int count, int& firstPageNo)
+{
+  Status status;
 
-  } else {                              // no free list, have to extend file
+  if (mapBase)
+    return FILEREADONLY;
+  if (count < 1 || count >= MAPGROUP - 1)
+    return BADPAGENO;
+
+  // look for count free pages in a row, skipping over fully
+  // allocated bytes of the map; pages below the first free page
+  // seen are all in use, so the hint can move past them
+
+  int first = -1;
+  int run = 0;
+  bool sawFree = false;
+  int pageNo = freeHint;
+  while (run < count) {
+    unsigned int g = pageNo / MAPGROUP;
+    int bit = pageNo % MAPGROUP;
+    if (run == 0 && bit % 8 == 0 && g < allocMap.size()
+	&& MAPBITS(g)[bit / 8] == 0xff) {
+      pageNo += 8;
+      if (!sawFree)
+	freeHint = pageNo;
+      continue;
+    }
 
-    // Extend file -- the current number of pages will be
-    // the page number of the page to be returned.
+    if (isFree(pageNo)) {
+      if (run++ == 0)
+	first = pageNo;
+      sawFree = true;
+    }
+    else {
+      run = 0;
+      if (!sawFree)
+	freeHint = pageNo + 1;
+    }
+    pageNo++;
+  }
 
-    pageNo = DBP(header).numPages;
-    Page newPage;
-    memset(&newPage, 0, sizeof newPage);
-    if ((status = intwrite(pageNo, &newPage)) != OK)
+  // create the map pages of any groups the run extends into,
+  // then mark the run as allocated
+
+  int last = first + count - 1;
+  while ((int)allocMap.size() <= last / MAPGROUP)
+    if ((status = addGroup()) != OK)
       return status;
 
-    DBP(header).numPages++;
+  for (int pageNo = first; pageNo <= last; pageNo++)
+    setInUse(pageNo, true);
+  if ((status = extend(last)) != OK)
+    return status;
+
+  if (first == freeHint)
+    freeHint = last + 1;
 
-    if (DBP(header).firstPage == -1)    // first user page in file?
-      DBP(header).firstPage = pageNo;
+  if (header.firstPage == -1) {         // first user page in file?
+    header.firstPage = first;
+    hdrDirty = true;
   }
 
-  if ((status = intwrite(0, &header)) != OK)
-    return status;
-  
+  firstPageNo = first;
+
 #ifdef DEBUGFREE
   listFree();
 #endif
@@ -285,42 +730,38 @@ Status File::allocatePage(int& pageNo)
 }
 
 
-// Deallocate a page from file. The page will be put on a free
-// list and returned back to the caller upon a subsequent
-// allocPage() call.
+// Deallocate a page from file. The page is marked free in the
+// allocation map and handed out again by a subsequent
+// allocatePage() call.
 
 const Status File::disposePage(const int pageNo)
 {
-  if (pageNo < 1)
-    return BADPAGENO;
+  pthread_mutex_lock(&mapLock);
+  Status status = freePage(pageNo);
+  pthread_mutex_unlock(&mapLock);
+  return status;
+}
 
-  Page header;
-  Status status;
 
-  if ((status = intread(0, &header)) != OK)
-    return status;
+const Status File::freePage(const int pageNo)
+{
+  if (mapBase)
+    return FILEREADONLY;
+  if (pageNo < 1)
+    return BADPAGENO;
 
   // The first user-allocated page in the file cannot be
   // disposed of. The File layer has no knowledge of what
   // is the next page in the file and hence would not be
   // able to adjust the firstPage field in file header.
 
-  if (DBP(header).firstPage == pageNo || pageNo >= DBP(header).numPages)
+  if (header.firstPage == pageNo || pageNo >= header.numPages
+      || isFree(pageNo) || pageNo % MAPGROUP == 0)
     return BADPAGENO;
 
-  // Deallocate page by attaching it to the free list.
-
-  Page away;
-  if ((status = intread(pageNo, &away)) != OK)
-    return status;
-  memset(&away, 0, sizeof away);
-  DBP(away).nextFree = DBP(header).nextFree;
-  DBP(header).nextFree = pageNo;
-
-  if ((status = intwrite(pageNo, &away)) != OK)
-    return status;
-  if ((status = intwrite(0, &header)) != OK)
-    return status;
+  setInUse(pageNo, false);
+  if (pageNo < freeHint)
+    freeHint = pageNo;
 
 #ifdef DEBUGFREE
   listFree();
@@ -335,23 +776,34 @@ const Status File::disposePage(const int pageNo)
 
 const Status File::intread(int pageNo, Page* pagePtr) const
 {
-  if (lseek(unixFile, pageNo * sizeof(Page), SEEK_SET) == -1)
-    return UNIXERR;
-
-  int nbytes = read(unixFile, (char*)pagePtr, sizeof(Page));
+  // Positional read: one system call per page and no dependence on
+  // the shared file offset. A direct read into an unaligned buffer
+  // goes through an aligned copy of its own, as other threads may
+  // be reading or writing the file at the same time.
+
+  Page* dest = aligned(pagePtr) ? pagePtr : newPage();
+  int nbytes = pread(unixFile, (char*)dest, PAGESIZE,
+		     (off_t)pageNo * PAGESIZE);
+  addStat(ioStats.reads);
+  if (dest != pagePtr) {
+    if (nbytes == (int)PAGESIZE)
+      memcpy(pagePtr, dest, PAGESIZE);
+    deletePage(dest);
+  }
 
 #ifdef DEBUGIO
   cerr << "%%  File " << (int)this << ": read bytes ";
-  cerr << pageNo * sizeof(Page) << ":+" << nbytes << endl;
+  cerr << pageNo * PAGESIZE << ":+" << nbytes << endl;
   cerr << "%%  ";
   for(int i = 0; i < 10; i++)
     cerr << *((int*)pagePtr + i) << " ";
   cerr << endl;
 #endif
 
-  if (nbytes != sizeof(Page))
+  if (nbytes != (int)PAGESIZE)
     return UNIXERR;
 
+  addStat(ioStats.pagesRead);
   return OK;
 }
 
@@ -361,23 +813,169 @@ const Status File::intread(int pageNo, Page* pagePtr) const
 
 const Status File::intwrite(const int pageNo, const Page* pagePtr)
 {
-  if (lseek(unixFile, pageNo * sizeof(Page), SEEK_SET) == -1)
-    return UNIXERR;
+  // an unaligned direct write goes through an aligned copy, as for
+  // intread
+  Page* copy = NULL;
+  if (!aligned(pagePtr)) {
+    copy = newPage();
+    memcpy(copy, pagePtr, PAGESIZE);
+  }
 
-  int nbytes = write(unixFile, (char*)pagePtr, sizeof(Page));
+  int nbytes = pwrite(unixFile, (char*)(copy ? copy : pagePtr), PAGESIZE,
+		      (off_t)pageNo * PAGESIZE);
+  addStat(ioStats.writes);
+  written();
+  if (copy)
+    deletePage(copy);
 
 #ifdef DEBUGIO
   cerr << "%%  File " << (int)this << ": wrote bytes ";
-  cerr << pageNo * sizeof(Page) << ":+" << nbytes << endl;
+  cerr << pageNo * PAGESIZE << ":+" << nbytes << endl;
   cerr << "%%  ";
   for(int i = 0; i < 10; i++)
     cerr << *((int*)pagePtr + i) << " ";
   cerr << endl;
 #endif
 
-  if (nbytes != sizeof(Page))
+  if (nbytes != (int)PAGESIZE)
     return UNIXERR;
 
+  addStat(ioStats.pagesWritten);
+  return OK;
+}
+
+
+// Check whether the filesystem allows direct I/O on whole pages:
+// page offsets and sizes must be multiples of its alignment, and so
+// must the page frames of a buffer pool allocated on IOALIGN. Sets
+// memAlign to the memory alignment required. Without statx the
+// traditional 512 byte sector alignment is assumed.
+
+bool File::canDirect()
+{
+  int offsetAlign = 512;
+  int bufAlign = 512;
+
+#ifdef STATX_DIOALIGN
+  struct statx stx;
+  if (statx(unixFile, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0
+      && (stx.stx_mask & STATX_DIOALIGN)) {
+    if (stx.stx_dio_offset_align == 0)
+      return false;                     // no direct I/O on this file
+    offsetAlign = stx.stx_dio_offset_align;
+    bufAlign = stx.stx_dio_mem_align;
+  }
+#endif
+
+  if (PAGESIZE % offsetAlign != 0 || PAGESIZE % bufAlign != 0
+      || IOALIGN % bufAlign != 0)
+    return false;
+
+  memAlign = bufAlign;
+  return true;
+}
+
+
+// Can pagePtr be handed to the kernel as is? Always true unless
+// the file uses direct I/O.
+
+bool File::aligned(const Page* pagePtr) const
+{
+  return !direct || (unsigned long)pagePtr % memAlign == 0;
+}
+
+
+// Read a run of consecutive pages starting at firstPageNo into the
+// (not necessarily contiguous) page buffers given by the caller.
+// The run is transferred with as few preadv calls as possible.
+
+const Status File::intreadv(const int firstPageNo, const int count,
+			    Page* pages[]) const
+{
+  struct iovec iov[MAXIOVPAGES];
+
+  // direct I/O cannot use unaligned buffers; fall back to single
+  // page reads through aligned copies
+  for (int i = 0; i < count; i++)
+    if (!aligned(pages[i])) {
+      Status status;
+      for (int j = 0; j < count; j++)
+	if ((status = intread(firstPageNo + j, pages[j])) != OK)
+	  return status;
+      return OK;
+    }
+
+  for (int done = 0; done < count; ) {
+    int n = count - done;
+    if (n > MAXIOVPAGES)
+      n = MAXIOVPAGES;
+    for (int i = 0; i < n; i++) {
+      iov[i].iov_base = (char*)pages[done + i];
+      iov[i].iov_len = PAGESIZE;
+    }
+
+    ssize_t nbytes = preadv(unixFile, iov, n,
+			    (off_t)(firstPageNo + done) * PAGESIZE);
+    addStat(ioStats.reads);
+
+#ifdef DEBUGIO
+    cerr << "%%  File " << (long)this << ": readv bytes ";
+    cerr << (firstPageNo + done) * PAGESIZE << ":+" << nbytes << endl;
+#endif
+
+    // a short transfer must end on a page boundary; loop for the rest
+    if (nbytes <= 0 || nbytes % PAGESIZE != 0)
+      return UNIXERR;
+    done += nbytes / PAGESIZE;
+    addStat(ioStats.pagesRead, nbytes / PAGESIZE);
+  }
+
+  return OK;
+}
+
+
+// Write a run of consecutive pages starting at firstPageNo from
+// the page buffers given by the caller, using pwritev.
+
+const Status File::intwritev(const int firstPageNo, const int count,
+			     const Page* pages[])
+{
+  struct iovec iov[MAXIOVPAGES];
+
+  for (int i = 0; i < count; i++)
+    if (!aligned(pages[i])) {
+      Status status;
+      for (int j = 0; j < count; j++)
+	if ((status = intwrite(firstPageNo + j, pages[j])) != OK)
+	  return status;
+      return OK;
+    }
+
+  for (int done = 0; done < count; ) {
+    int n = count - done;
+    if (n > MAXIOVPAGES)
+      n = MAXIOVPAGES;
+    for (int i = 0; i < n; i++) {
+      iov[i].iov_base = (char*)pages[done + i];
+      iov[i].iov_len = PAGESIZE;
+    }
+
+    ssize_t nbytes = pwritev(unixFile, iov, n,
+			     (off_t)(firstPageNo + done) * PAGESIZE);
+    addStat(ioStats.writes);
+    written();
+
+#ifdef DEBUGIO
+    cerr << "%%  File " << (long)this << ": wrotev bytes ";
+    cerr << (firstPageNo + done) * PAGESIZE << ":+" << nbytes << endl;
+#endif
+
+    if (nbytes <= 0 || nbytes % PAGESIZE != 0)
+      return UNIXERR;
+    done += nbytes / PAGESIZE;
+    addStat(ioStats.pagesWritten, nbytes / PAGESIZE);
+  }
+
   return OK;
 }
 
@@ -399,6 +997,8 @@ const Status File::readPage(const int pageNo, Page* pagePtr) const
 
 const Status File::writePage(const int pageNo, const Page *pagePtr)
 {
+  if (mapBase)
+    return FILEREADONLY;
   if (!pagePtr)
     return BADPAGEPTR;
   if (pageNo < 1)
@@ -408,18 +1008,297 @@ const Status File::writePage(const int pageNo, const Page *pagePtr)
 }
 
 
+// Read count consecutive pages, check parameters for validity.
+
+const Status File::readPages(const int firstPageNo, const int count,
+			     Page* pages[]) const
+{
+  if (!pages)
+    return BADPAGEPTR;
+  if (firstPageNo < 1 || count < 1)
+    return BADPAGENO;
+  for (int i = 0; i < count; i++)
+    if (!pages[i])
+      return BADPAGEPTR;
+
+  return intreadv(firstPageNo, count, pages);
+}
+
+
+// Write count consecutive pages, check parameters for validity.
+
+const Status File::writePages(const int firstPageNo, const int count,
+			      const Page* pages[])
+{
+  if (mapBase)
+    return FILEREADONLY;
+  if (!pages)
+    return BADPAGEPTR;
+  if (firstPageNo < 1 || count < 1)
+    return BADPAGENO;
+  for (int i = 0; i < count; i++)
+    if (!pages[i])
+      return BADPAGEPTR;
+
+  return intwritev(firstPageNo, count, pages);
+}
+
+
+// Queue a transfer of one page to or from the file.
+
+const Status File::intasync(const int pageNo, const Page* pagePtr,
+			    const bool write, IOHandle& handle) const
+{
+  IORequest* req = new IORequest;
+  req->file = this;
+  req->pageNo = pageNo;
+  req->fd = unixFile;
+  req->offset = (off_t)pageNo * PAGESIZE;
+  req->iov.iov_base = (char*)pagePtr;
+  req->iov.iov_len = PAGESIZE;
+  req->write = write;
+  req->sync = false;
+
+  Status status = ioEngine()->submit(req);
+  if (status != OK) {
+    delete req;
+    return status;
+  }
+  handle = req;
+  return OK;
+}
+
+
+// Queue an fdatasync of the file.
+
+const Status File::syncAsync(IOHandle& handle)
+{
+  IORequest* req = new IORequest;
+  req->file = this;
+  req->pageNo = -1;
+  req->fd = unixFile;
+  req->offset = 0;
+  req->iov.iov_base = NULL;
+  req->iov.iov_len = 0;
+  req->write = false;
+  req->sync = true;
+
+  Status status = ioEngine()->submit(req);
+  if (status != OK) {
+    delete req;
+    handle = NULL;
+    return status;
+  }
+  handle = req;
+  return OK;
+}
+
+
+// Put the file on the list of files that DB::syncFiles must sync.
+
+void File::written()
+{
+  if (__atomic_load_n(&unsynced, __ATOMIC_ACQUIRE))
+    return;
+  pthread_mutex_lock(&syncLock);
+  if (!unsynced) {
+    syncNext = unsyncedFiles;
+    unsyncedFiles = this;
+    __atomic_store_n(&unsynced, true, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&syncLock);
+}
+
+
+// Take the file off the list of files to sync.
+
+void File::synced()
+{
+  pthread_mutex_lock(&syncLock);
+  if (unsynced) {
+    File** link = &unsyncedFiles;
+    while (*link != this)
+      link = &(*link)->syncNext;
+    *link = syncNext;
+    syncNext = NULL;
+    __atomic_store_n(&unsynced, false, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&syncLock);
+}
+
+
+// Start reading a page from file; the page must not be used until
+// waitIO has been called on the handle. A direct read into an
+// unaligned buffer has to go through an aligned copy and is
+// carried out at once; handle is then NULL.
+
+const Status File::readPageAsync(const int pageNo, Page* pagePtr,
+				 IOHandle& handle) const
+{
+  if (!pagePtr)
+    return BADPAGEPTR;
+  if (pageNo < 1)
+    return BADPAGENO;
+
+  handle = NULL;
+  if (!aligned(pagePtr))
+    return intread(pageNo, pagePtr);
+  return intasync(pageNo, pagePtr, false, handle);
+}
+
+
+// Start writing a page to file; the page must not be changed until
+// waitIO has been called on the handle. Unaligned direct writes are
+// synchronous, as for readPageAsync.
+
+const Status File::writePageAsync(const int pageNo, const Page* pagePtr,
+				  IOHandle& handle)
+{
+  if (mapBase)
+    return FILEREADONLY;
+  if (!pagePtr)
+    return BADPAGEPTR;
+  if (pageNo < 1)
+    return BADPAGENO;
+
+  handle = NULL;
+  if (!aligned(pagePtr))
+    return intwrite(pageNo, pagePtr);
+  written();
+  return intasync(pageNo, pagePtr, true, handle);
+}
+
+
+// Check whether a transfer started by readPageAsync or
+// writePageAsync has completed.
+
+bool File::ioDone(const IOHandle handle)
+{
+  return !handle || ioEngine()->poll(handle);
+}
+
+
+// Wait for a transfer started by readPageAsync or writePageAsync to
+// complete and release its handle. The transfer is counted in the
+// I/O statistics of its file. If nanos is given, it is set to the
+// time from queueing the transfer to its completion, 0 for a
+// transfer carried out synchronously.
+
+const Status File::waitIO(IOHandle& handle, long long* nanos)
+{
+  if (nanos)
+    *nanos = 0;
+  if (!handle)
+    return OK;
+
+  IORequest* req = handle;
+  handle = NULL;
+  ioEngine()->wait(req);
+
+  IOStats & stats = req->file->ioStats;
+  bool ok = req->result == (req->sync ? 0 : (int)PAGESIZE);
+  if (nanos)
+    *nanos = req->finished - req->queued;
+  if (req->sync)
+    addStat(stats.syncs);
+  else if (req->write) {
+    addStat(stats.writes);
+    if (ok) addStat(stats.pagesWritten);
+  }
+  else {
+    addStat(stats.reads);
+    if (ok) addStat(stats.pagesRead);
+  }
+
+#ifdef DEBUGIO
+  cerr << "%%  File " << (long)req->file << ": async "
+       << (req->write ? "wrote" : "read") << " bytes "
+       << req->offset << ":+" << req->result << endl;
+#endif
+
+  delete req;
+  return ok ? OK : UNIXERR;
+}
+
+
 // Return the number of the first page in file. It is stored
-// on the file's header page (field firstPage).
+// on the file's header page (field firstPage), which is cached
+// while the file is open.
 
 const Status File::getFirstPage(int& pageNo) const
 {
-  Page header;
-  Status status;
+  pageNo = header.firstPage;
 
-  if ((status = intread(0, &header)) != OK)
-    return status;
+  return OK;
+}
 
-  pageNo = DBP(header).firstPage;
+
+// Return the address of a page in the mapping of a mapped file.
+// The page must not be modified.
+
+const Status File::mapPage(const int pageNo, Page*& pagePtr) const
+{
+  if (!mapBase)
+    return BADFILE;
+  if (pageNo < 1 || pageNo >= mapPages)
+    return BADPAGENO;
+
+  pagePtr = mapBase + pageNo;
+  return OK;
+}
+
+
+// Tell the kernel how pages firstPageNo .. firstPageNo+count-1 are
+// going to be accessed; a count of 0 means up to the end of the
+// file. Mapped files get madvise(2) on the mapping, other files
+// posix_fadvise(2) on the descriptor. Hints are only advice, so a
+// kernel that ignores them is not an error.
+
+const Status File::advise(const int firstPageNo, const int count,
+			  const AccessHint hint) const
+{
+  if (firstPageNo < 0 || count < 0)
+    return BADPAGENO;
+
+  int lastPageNo = header.numPages;
+  if (count > 0 && firstPageNo + count < lastPageNo)
+    lastPageNo = firstPageNo + count;
+  if (mapBase && mapPages < lastPageNo)
+    lastPageNo = mapPages;
+  if (firstPageNo >= lastPageNo)
+    return OK;
+
+  if (mapBase)
+    {
+      int advice = MADV_NORMAL;
+      if (hint == SEQACCESS) advice = MADV_SEQUENTIAL;
+      else if (hint == RANDACCESS) advice = MADV_RANDOM;
+      else if (hint == WILLNEED) advice = MADV_WILLNEED;
+
+      // madvise wants an address on a VM page boundary; the
+      // mapping itself starts on one
+
+      unsigned long vmPage = sysconf(_SC_PAGESIZE);
+      char* start = (char*)(mapBase + firstPageNo);
+      char* end = (char*)(mapBase + lastPageNo);
+      start -= (start - (char*)mapBase) % vmPage;
+      if (madvise(start, end - start, advice) < 0)
+	return UNIXERR;
+    }
+  else
+    {
+#ifdef POSIX_FADV_NORMAL
+      int advice = POSIX_FADV_NORMAL;
+      if (hint == SEQACCESS) advice = POSIX_FADV_SEQUENTIAL;
+      else if (hint == RANDACCESS) advice = POSIX_FADV_RANDOM;
+      else if (hint == WILLNEED) advice = POSIX_FADV_WILLNEED;
+
+      if (posix_fadvise(unixFile, (off_t)firstPageNo * PAGESIZE,
+			(off_t)(lastPageNo - firstPageNo) * PAGESIZE,
+			advice) != 0)
+	return UNIXERR;
+#endif
+    }
 
   return OK;
 }
@@ -427,20 +1306,17 @@ const Status File::getFirstPage(int& pageNo) const
 
 #ifdef DEBUGFREE
 
-// Print out the page numbers on the free list. For debugging only.
+// Print out the first few free page numbers. For debugging only.
 
 void File::listFree()
 {
-  cerr << "%%  File " << (int)this << " free pages:";
-  int pageNo = 0;
-  for(int i = 0; i < 10; i++) {
-    Page page;
-    if (intread(pageNo, &page) != OK)
-      break;
-    pageNo = DBP(page).nextFree;
-    cerr << " " << pageNo;
-    if (pageNo == -1)
-      break;
+  cerr << "%%  File " << (long)this << " free pages:";
+  int found = 0;
+  for(int pageNo = 0; pageNo < header.numPages && found < 10; pageNo++) {
+    if (isFree(pageNo)) {
+      cerr << " " << pageNo;
+      found++;
+    }
   }
   cerr << endl;
 }
@@ -452,11 +1328,17 @@ void File::listFree()
 
 DB::DB()
 {
-  // Check that DB header page data fits on a regular data page.
+  directIO = false;
+  lruHead = lruTail = NULL;
+  cachedFiles = 0;
+  maxCachedFiles = DEFFILECACHE;
+
+  // Check that DB header page data fits in the area reserved for
+  // it in front of the allocation map.
 
-  if (sizeof(DBPage) >= sizeof(Page)) {
-    cerr << "sizeof(DBPage) cannot exceed sizeof(Page): "
-         << sizeof(DBPage) << " " << sizeof(Page) << endl;
+  if (sizeof(DBPage) > MAPHDR || MAPHDR >= MINPAGESIZE) {
+    cerr << "sizeof(DBPage) cannot exceed MAPHDR: "
+         << sizeof(DBPage) << " " << MAPHDR << endl;
     exit(1);
   }
 }
@@ -466,6 +1348,9 @@ DB::DB()
 
 DB::~DB()
 {
+  delete asyncIO;
+  asyncIO = NULL;
+
   // this could leave some open files open.
   // need to fix this by iterating through the hash table deleting each open file
 }
@@ -474,17 +1359,19 @@ DB::~DB()
   
 // Create a database file.
 
-const Status DB::createFile(const string &fileName) 
+const Status DB::createFile(const string &fileName, const int extentPages) 
 {
   File*  file;
   if (fileName.empty())
     return BADFILE;
+  if (extentPages < MINEXTENT || extentPages > MAXEXTENT)
+    return BADEXTENT;
 
   // First check if the file has already been opened
   if (openFiles.find(fileName, file) == OK) return FILEEXISTS;
 
   // Do the actual work
-  return File::create(fileName);
+  return File::create(fileName, extentPages);
 }
 
 
@@ -496,8 +1383,14 @@ const Status DB::destroyFile(const string & fileName)
 
   if (fileName.empty()) return BADFILE;
 
-  // Make sure file is not open currently.
-  if (openFiles.find(fileName, file) == OK) return FILEOPEN;
+  // Make sure file is not open currently. A closed file whose unix
+  // file is still cached is closed for good first.
+  if (openFiles.find(fileName, file) == OK) {
+    if (file->openCnt > 0) return FILEOPEN;
+    file->synced();                     // no point in syncing it
+    Status status = evictFile(file);
+    if (status != OK) return status;
+  }
   
   // Do the actual work
   return File::destroy(fileName);
@@ -506,9 +1399,11 @@ const Status DB::destroyFile(const string & fileName)
 
 // Open a database file. If file already open, increment open count,
 // otherwise find a vacant slot in the open files table and store
-// file info there.
+// file info there. A file opened in MAPPED mode is mapped read-only
+// by its first opener.
 
-const Status DB::openFile(const string & fileName, File*& filePtr)
+const Status DB::openFile(const string & fileName, File*& filePtr,
+			  const AccessMode mode)
 {
   Status status;
   File* file;
@@ -519,8 +1414,18 @@ const Status DB::openFile(const string & fileName, File*& filePtr)
   if (openFiles.find(fileName, file) == OK) 
   {
       // file is already open, call open again on the file object
-      // to increment it's open count.
-      status = file->open();
+      // to increment it's open count. A cached closed file is
+      // reopened without any system calls.
+      pthread_mutex_lock(&mapLock);
+      if (file->openCnt == 0)
+	uncacheFile(file);
+      status = file->open(mode, directIO);
+      pthread_mutex_unlock(&mapLock);
+      if (status != OK && file->openCnt == 0)
+	{
+	  evictFile(file);
+	  return status;
+	}
       filePtr = file;
   }
   else
@@ -528,7 +1433,7 @@ const Status DB::openFile(const string & fileName, File*& filePtr)
       // file is not already open
       // Otherwise create a new file object and open it
       filePtr = new File(fileName);
-      status = filePtr->open();
+      status = filePtr->open(mode, directIO);
 
       if (status != OK)
 	{
@@ -543,6 +1448,29 @@ const Status DB::openFile(const string & fileName, File*& filePtr)
 }
 
 
+// Return the page size of an existing file, which is the page size
+// of the database the file belongs to. Only the DB header is read,
+// so this works before the page size has been set.
+
+const Status DB::getPageSize(const string & fileName, unsigned & pageSize)
+{
+  int file;
+  DBPage header;
+
+  if (fileName.empty()) return BADFILE;
+
+  if ((file = ::open(fileName.c_str(), O_RDONLY)) < 0)
+    return UNIXERR;
+  int nbytes = pread(file, (char*)&header, sizeof header, 0);
+  ::close(file);
+  if (nbytes != sizeof header)
+    return UNIXERR;
+
+  pageSize = header.pageSize;
+  return OK;
+}
+
+
 // Close a database file. Get file info from open files table,
 // call Unix close() only if open count now goes to zero.
 
@@ -552,16 +1480,129 @@ const Status DB::closeFile(File* file)
 
 
   // Close the file
-  file->close();
+  if (file->close() == FILENOTOPEN) return FILENOTOPEN;
 
-  // If there are no remaining references to the file, then we should delete
-  // the file object and remove it from the openFilesMap
+  // If there are no remaining references to the file, keep its unix
+  // file open on the LRU list so that reopening it is cheap. The
+  // least recently closed files are closed for good when the list
+  // is longer than the cache limit.
 
   if (file->openCnt == 0)
     {
-      if (openFiles.erase(file->fileName) != OK) return BADFILEPTR;
-      delete file;
+      cacheFile(file);
+      while (cachedFiles > maxCachedFiles)
+	{
+	  Status status = evictFile(lruTail);
+	  if (status != OK) return status;
+	}
     }
 
   return OK;
 }
+
+
+// Make the writes to all DB files so far durable. The header and
+// allocation map of every file changed since the last sync are
+// written back, then an fdatasync of each of these files is queued
+// with the I/O engine and all of them are waited for together, so
+// the whole group costs about as much as one sync. Pages still dirty
+// in the buffer pool are not written; BufMgr::flushAll(true) writes
+// them first.
+
+const Status DB::syncFiles()
+{
+  Status status = OK;
+  vector<File*> files;
+  pthread_mutex_lock(&mapLock);
+  pthread_mutex_lock(&syncLock);
+  for (File* file = unsyncedFiles; file; file = file->syncNext)
+    files.push_back(file);
+  pthread_mutex_unlock(&syncLock);
+
+  for (unsigned int i = 0; i < files.size(); i++) {
+    Status mapStatus = files[i]->writeMap();
+    if (mapStatus != OK)
+      status = mapStatus;
+  }
+
+  // a file that fails to sync goes back on the list
+  vector<IOHandle> handles(files.size(), (IOHandle)NULL);
+  for (unsigned int i = 0; i < files.size(); i++) {
+    files[i]->synced();
+    Status syncStatus = files[i]->syncAsync(handles[i]);
+    if (syncStatus != OK) {
+      files[i]->written();
+      status = syncStatus;
+    }
+  }
+  for (unsigned int i = 0; i < files.size(); i++)
+    if (handles[i] && File::waitIO(handles[i]) != OK) {
+      files[i]->written();
+      status = UNIXERR;
+    }
+  pthread_mutex_unlock(&mapLock);
+
+  return status;
+}
+
+
+// Set the number of closed files whose unix files are kept open;
+// 0 closes every file as soon as it is closed.
+
+const Status DB::setFileCache(const int maxFiles)
+{
+  if (maxFiles < 0) return BADFILE;
+
+  maxCachedFiles = maxFiles;
+  while (cachedFiles > maxCachedFiles)
+    {
+      Status status = evictFile(lruTail);
+      if (status != OK) return status;
+    }
+  return OK;
+}
+
+
+// Put a closed file at the head of the LRU list.
+
+void DB::cacheFile(File* file)
+{
+  file->lruPrev = NULL;
+  file->lruNext = lruHead;
+  if (lruHead) lruHead->lruPrev = file;
+  else lruTail = file;
+  lruHead = file;
+  cachedFiles++;
+}
+
+
+// Take a file off the LRU list.
+
+void DB::uncacheFile(File* file)
+{
+  if (file->lruPrev) file->lruPrev->lruNext = file->lruNext;
+  else lruHead = file->lruNext;
+  if (file->lruNext) file->lruNext->lruPrev = file->lruPrev;
+  else lruTail = file->lruPrev;
+  file->lruPrev = file->lruNext = NULL;
+  cachedFiles--;
+}
+
+
+// Close the unix file of a cached file, remove it from the open
+// files table and delete the file object.
+
+const Status DB::evictFile(File* file)
+{
+  pthread_mutex_lock(&mapLock);
+  if (file->lruPrev || file->lruNext || lruHead == file)
+    uncacheFile(file);
+
+  Status status = file->release();
+  if (openFiles.erase(file->fileName) != OK)
+    status = BADFILEPTR;
+  else
+    delete file;
+  pthread_mutex_unlock(&mapLock);
+  return status;
+}
@@ -3,7 +3,9 @@
 
 #include <sys/types.h>
 #include <functional>
+#include <vector>
 #include "error.h"
+#include "aio.h"
 #include <string.h>
 using namespace std;
 
@@ -14,21 +16,147 @@ using namespace std;
 
 // forward class definition for db
 class DB;
+class Page;
 
-// class definition for open files
+
+// structure of DB (header) page
+
+typedef struct {
+  int firstPage;                        // page # of first page in file
+  int numPages;                         // total # of pages in file
+  int mapGroups;                        // # of allocation map pages
+  int extentPages;                      // # of pages file grows by
+  int pageSize;                         // page size of file in bytes
+} DBPage;
+
+// files grow by whole extents; the extent size is fixed when the
+// file is created
+
+const int MINEXTENT = 1;
+const int MAXEXTENT = 1024;
+const int DEFEXTENT = 64;
+
+// alignment of memory that direct I/O transfers may use; buffer
+// pools are allocated on this boundary
+
+const int IOALIGN = 4096;
+
+// access modes of an open file. A MAPPED file is mapped into memory
+// read-only and the buffer manager hands out pointers into the
+// mapping instead of copying its pages into the buffer pool.
+
+enum AccessMode { READWRITE, MAPPED };
+
+// access pattern hints for File::advise()
+
+enum AccessHint { NORMALACCESS, SEQACCESS, RANDACCESS, WILLNEED };
+
+// per-file I/O statistics; one read or write is one system call
+
+struct IOStats
+{
+  int reads;       // Number of read system calls issued
+  int writes;      // Number of write system calls issued
+  int pagesRead;   // Number of pages read from the file
+  int pagesWritten;// Number of pages written to the file
+  int extends;     // Number of times the file was grown
+  int syncs;       // Number of times the file was synced to disk
+
+  void clear()
+    {
+      reads = writes = pagesRead = pagesWritten = extends = syncs = 0;
+    }
+
+  IOStats()
+    {
+      clear();
+    }
+};
+
+// buffer pool counters of a file, kept by the buffer manager while
+// the file object exists
+
+struct BufFileStats
+{
+  long long hits;           // Number of page requests found in the pool
+  long long misses;         // Number of page requests read from the file
+  long long evictions;      // Number of its pages replaced by others
+  long long dirtyEvictions; // Number of those written out to be replaced
+
+  void clear()
+    {
+      hits = misses = evictions = dirtyEvictions = 0;
+    }
+
+  BufFileStats()
+    {
+      clear();
+    }
+};
+
+// class definition for open files. Pages of an open file may be read
+// and written by several threads at once; allocating and disposing
+// of pages, and opening and closing files, must not overlap with
+// other operations on the file, except for DB::syncFiles, which a
+// checkpoint may run on another thread.
 class File {
   friend class DB;
   friend class OpenFileHashTbl;
+  friend class BufMgr;
 
  public:
 
   Status allocatePage(int& pageNo);     // allocate a new page
+  Status allocatePages(const int count,
+		       int& firstPageNo);   // allocate a run of contiguous pages
   const Status disposePage(const int pageNo);       // release space for a page
   const Status readPage(const int pageNo,
 		  Page* pagePtr) const;       // read page from file
   const Status writePage(const int pageNo,
 		   const Page* pagePtr);      // write page to file
+  const Status readPages(const int firstPageNo, const int count,
+		  Page* pages[]) const;       // read run of consecutive pages
+  const Status writePages(const int firstPageNo, const int count,
+		   const Page* pages[]);      // write run of consecutive pages
+  const Status readPageAsync(const int pageNo, Page* pagePtr,
+		  IOHandle& handle) const;    // start reading page from file
+  const Status writePageAsync(const int pageNo, const Page* pagePtr,
+		   IOHandle& handle);         // start writing page to file
+  static bool ioDone(const IOHandle handle); // has transfer completed?
+  static const Status waitIO(IOHandle& handle,
+		  long long* nanos = NULL);   // wait for transfer; its duration
   const Status getFirstPage(int& pageNo) const;     // returns pageNo of first page
+  const Status mapPage(const int pageNo,
+		 Page*& pagePtr) const;      // address of page in mapping
+  const Status advise(const int firstPageNo, const int count,
+		const AccessHint hint) const; // hint expected access pattern
+  bool isAllocated(const int pageNo) const; // is page an allocated data page?
+
+  bool isMapped() const                 // is file mapped read-only?
+  {
+	return mapBase != NULL;
+  }
+  bool isDirect() const                 // does file bypass the OS cache?
+  {
+	return direct;
+  }
+
+  const IOStats & getIOStats() const    // get I/O counters of this file
+  {
+	return ioStats;
+  }
+  void clearIOStats()
+  {
+	ioStats.clear();
+  }
+  const BufFileStats & getBufStats() const // get buffer pool counters
+  {
+	return bufStats;
+  }
+  const string & getName() const        // name the file was opened by
+  {
+	return fileName;
+  }
 
   bool operator == (const File & other) const
     {
@@ -40,16 +168,40 @@ class File {
   File(const string &fname);                   // initialize
   ~File();                  // deallocate file object
 
-  static const Status create(const string &fileName);
+  static const Status create(const string &fileName,
+			     const int extentPages);
   static const Status destroy(const string &fileName);
 
-  const Status open();
+  const Status open(const AccessMode mode, const bool directIO);
+  const Status release();               // close unix file of closed file
+  void setDirect(const bool on);        // switch direct I/O on or off
+  bool canDirect();                     // direct I/O possible on file?
+  bool aligned(const Page* pagePtr) const; // buffer usable for I/O?
   const Status close();
 
   const Status intread(const int pageNo,
 		 Page* pagePtr) const;        // internal file read
   const Status intwrite(const int pageNo,
 		  const Page* pagePtr);       // internal file write
+  const Status intreadv(const int firstPageNo, const int count,
+		  Page* pages[]) const;       // internal vectored read
+  const Status intwritev(const int firstPageNo, const int count,
+		   const Page* pages[]);      // internal vectored write
+  const Status intasync(const int pageNo, const Page* pagePtr,
+		  const bool write, IOHandle& handle) const; // queue transfer
+  const Status syncAsync(IOHandle& handle); // queue fdatasync of file
+  void written();                       // note file has unsynced changes
+  void synced();                        // note file has none
+
+  const Status readMap();               // load header and allocation map
+  const Status writeMap();              // write back dirty header and map
+  Status allocRun(const int count,
+		  int& firstPageNo);        // allocatePages under mapLock
+  const Status freePage(const int pageNo); // disposePage under mapLock
+  const Status addGroup();              // add an allocation map page
+  const Status extend(const int pageNo); // grow file to include pageNo
+  bool isFree(const int pageNo) const;  // is page unallocated?
+  void setInUse(const int pageNo, const bool inUse); // update map bit
 
 #ifdef DEBUGFREE
   void listFree();                      // list free pages
@@ -58,6 +210,24 @@ class File {
   string fileName;                    // The name of the file
   int openCnt;                        // # times file has been opened
   int unixFile;                       // unix file stream for file
+  mutable IOStats ioStats;            // I/O counters for this file
+  mutable BufFileStats bufStats;      // buffer pool counters for this file
+
+  DBPage header;                      // cached copy of the header page
+  bool hdrDirty;                      // true if header must be written
+  vector<Page*> allocMap;             // allocation map, one page per group
+  vector<bool> mapDirty;              // true if map page must be written
+  int freeHint;                       // no free page below this page #
+  Page* mapBase;                      // start of mapping, NULL if not mapped
+  int mapPages;                       // # of pages mapped
+  bool direct;                        // true if opened with O_DIRECT
+  int memAlign;                       // buffer alignment direct I/O needs
+  File* lruPrev;                      // neighbours in the DB's list of
+  File* lruNext;                      // closed files kept open
+  bool unsynced;                      // true if changed since last sync
+  File* syncNext;                     // next file with unsynced changes
+  int bufFrames;                      // first frame of the buffer pool
+                                      // holding a page of the file, -1
 };
 
 class BufMgr;
@@ -68,34 +238,45 @@ struct fileHashBucket
 {
 	string	fname;    // name of the file
         File*   file;    // pointer to file object
+	unsigned int hashVal; // hash value of fname
 	fileHashBucket* next;	 // next node in the hash table
 	
 };
 
-// hash table to keep track of open files
+// hash table to keep track of open files. The table doubles in size
+// when it holds more entries than it has buckets.
 class OpenFileHashTbl
 {
 private:
-    int HTSIZE;
+    int HTSIZE;    // # of buckets, a power of two
+    int numEntries; // # of files in the table
     fileHashBucket**  ht; // actual hash table
-    int	 hash(string fileName);  // returns value between 0 and HTSIZE-1
+    static unsigned int hash(const string & fileName);  // hash of a file name
+    void grow();   // double the number of buckets
 
 public:
     OpenFileHashTbl();
     ~OpenFileHashTbl(); // destructor
 	
     // returns OK if no error occured, HASHTBLERROR if an error occurred
-    Status insert(const string fileName, File* file);
+    Status insert(const string & fileName, File* file);
 
     // see if fileName is already in hash table.  If so a pointer to the file
     // object is returned.
     // returns OK if found. else returns HASHNOTFOUND
-    Status find(const string fileName, File*& file);
+    Status find(const string & fileName, File*& file) const;
 
     // returns OK if fileName was found.  Else return HASHTBLERROR
-    Status erase(const string fileName);
+    Status erase(const string & fileName);
+
+    // appends every file in the table to files
+    void list(vector<File*> & files) const;
 };
 
+// default # of closed files whose unix files the DB keeps open
+
+const int DEFFILECACHE = 32;
+
 
 
 class DB {
@@ -103,23 +284,39 @@ class DB {
   DB();                                 // initialize open file table
   ~DB();                                // clean up any remaining open files
 
-  const Status createFile(const string & fileName) ;  // create a new file
+  const Status createFile(const string & fileName,
+			  const int extentPages = DEFEXTENT); // create a new file
   const Status destroyFile(const string & fileName) ; // destroy a file, 
                                                            // release all space
-  const Status openFile(const string & fileName, File* & file);  // open a file
+  const Status openFile(const string & fileName, File* & file,
+			const AccessMode mode = READWRITE);  // open a file
   const Status closeFile(File* file);         // close a file
+  const Status getPageSize(const string & fileName,
+			   unsigned & pageSize); // page size of a file
+  static const Status syncFiles();      // make all file writes durable
 
- private:
-  OpenFileHashTbl   openFiles;    // list of open files
-};
+  void setDirectIO(const bool on)       // open files with O_DIRECT?
+  {
+	directIO = on;
+  }
+  const Status setFileCache(const int maxFiles); // # closed files kept open
+  void listFiles(vector<File*> & files) const // open and cached files
+  {
+	openFiles.list(files);
+  }
 
+ private:
+  void cacheFile(File* file);           // put closed file on LRU list
+  void uncacheFile(File* file);         // take file off LRU list
+  const Status evictFile(File* file);   // really close a cached file
 
-// structure of DB (header) page
+  OpenFileHashTbl   openFiles;    // list of open and cached files
+  bool              directIO;     // bypass OS cache for newly opened files
+  File*             lruHead;      // most recently closed cached file
+  File*             lruTail;      // least recently closed cached file
+  int               cachedFiles;  // # of files on the LRU list
+  int               maxCachedFiles; // limit on cachedFiles
+};
 
-typedef struct {
-  int nextFree;                         // page # of next page on free list
-  int firstPage;                        // page # of first page in file
-  int numPages;                         // total # of pages in file
-} DBPage;
 
 #endif
@@ -17,10 +17,15 @@ AttrCatalog *attrCat;
 int main(int argc, char *argv[])
 {
   if (argc < 2) {
-    cerr << "Usage: " << argv[0] << " dbname" << endl;
+    cerr << "Usage: " << argv[0] << " dbname [pagesize]" << endl;
     return 1;
   }
 
+  // all files of the database use the page size given here
+
+  if (argc > 2)
+    CALL(setPageSize(atoi(argv[2])));
+
   // create database subdirectory and chdir there
 
   if (mkdir(argv[1], S_IRUSR | S_IWUSR | S_IXUSR
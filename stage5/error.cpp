@@ -24,6 +24,9 @@ void Error::print(Status status)
     case BADPAGEPTR:   cerr << "bad page pointer"; break;
     case BADPAGENO:    cerr << "bad page number"; break;
     case FILEEXISTS:   cerr << "file exists already"; break;
+    case BADEXTENT:    cerr << "bad extent size"; break;
+    case FILEREADONLY: cerr << "file is mapped read-only"; break;
+    case BADPAGESIZE:  cerr << "bad page size"; break;
 
     // BufMgr and HashTable errors
 
@@ -33,6 +36,8 @@ void Error::print(Status status)
     case PAGENOTPINNED: cerr << "page not pinned"; break;
     case BADBUFFER: cerr << "buffer pool corrupted"; break;
     case PAGEPINNED: cerr << "page still pinned"; break;
+    case WRITERRUNNING: cerr << "background writer already running"; break;
+    case BADPOOLSIZE: cerr << "bad buffer pool size"; break;
 
     // Page class errors
 
@@ -41,6 +46,7 @@ void Error::print(Status status)
     case ENDOFPAGE: cerr << "last record on page"; break;
     case INVALIDSLOTNO: cerr << "invalid slot number"; break;
     case INVALIDRECLEN: cerr << "specified record length <= 0";break;
+    case BADFIELD: cerr << "field not within one column of record"; break;
 
     // Heap file errors
 
@@ -80,6 +86,11 @@ void Error::print(Status status)
     case TMP_RES_EXISTS:    cerr << "temp result already exists"; break;    
     case INDEXEXISTS:  cerr << "index exists already"; break;
 
+    // Utility errors
+
+    case BADSETTING:   cerr << "unknown setting"; break;
+    case BADLAYOUT:    cerr << "unknown page layout"; break;
+
     default:           cerr << "undefined error status: " << status;
   }
   cerr << endl;
@@ -17,16 +17,18 @@ enum Status {
 // File and DB errors
 
        BADFILEPTR, BADFILE, FILETABFULL, FILEOPEN, FILENOTOPEN,
-       UNIXERR, BADPAGEPTR, BADPAGENO, FILEEXISTS,
+       UNIXERR, BADPAGEPTR, BADPAGENO, FILEEXISTS, BADEXTENT,
+       FILEREADONLY, BADPAGESIZE,
 
 // BufMgr and HashTable errors
 
        HASHTBLERROR, HASHNOTFOUND, BUFFEREXCEEDED, PAGENOTPINNED,
-       BADBUFFER, PAGEPINNED,
+       BADBUFFER, PAGEPINNED, WRITERRUNNING, BADPOOLSIZE,
 
 // Page errors
 	
        NOSPACE,  NORECORDS,  ENDOFPAGE, INVALIDSLOTNO, INVALIDRECLEN,
+       BADFIELD,
 
 // HeapFile errors
 
@@ -49,6 +51,8 @@ enum Status {
 
 // Utility errors
 
+       BADSETTING, BADLAYOUT,
+
 // Query errors
 
        ATTRTYPEMISMATCH, TMP_RES_EXISTS,
@@ -1,8 +1,13 @@
 #include "heapfile.h"
 #include "error.h"
 
-// routine to create a heapfile
-const Status createHeapFile(const string fileName)
+// routine to create a heapfile; the file grows extentPages
+// pages at a time, and its data pages are initialized with pageFlags.
+// With FIXEDREC, all records are recLen bytes long; with PAX, they are
+// split into colCnt columns of widths colLen.
+const Status createHeapFile(const string fileName, const int extentPages,
+			    const int pageFlags, const int recLen,
+			    const int colCnt, const short colLen[])
 {
     File* 		file;
     Status 		status;
@@ -11,13 +16,29 @@ const Status createHeapFile(const string fileName)
     int			newPageNo;
     Page*		newPage;
 
+    if ((pageFlags & FIXEDREC)
+	&& (recLen < 1 || (unsigned)recLen > Page::maxRecLen(pageFlags)))
+	return INVALIDRECLEN;
+    if (pageFlags & PAX)
+    {
+	if (!(pageFlags & FIXEDREC) || colCnt < 1 || colCnt > MAXCOLUMNS)
+	    return BADCATPARM;
+	int len = 0;
+	for (int c = 0; c < colCnt; c++)
+	{
+	    if (colLen[c] < 1) return INVALIDRECLEN;
+	    len += colLen[c];
+	}
+	if (len != recLen) return INVALIDRECLEN;
+    }
+
     // try to open the file. This should return an error
     status = db.openFile(fileName, file);
     if (status != OK)
     {
 	// file doesn't exist. First create it and allocate
 	// an empty header page and data page.
-	status = db.createFile(fileName);
+	status = db.createFile(fileName, extentPages);
 	if (status != OK) return (status);
 
 	// then open it
@@ -37,13 +58,24 @@ const Status createHeapFile(const string fileName)
 	if (status != OK) return (status);
 
 	// initialize the empty data page
-	newPage->init(newPageNo);
+	newPage->init(newPageNo, pageFlags, recLen, colCnt, colLen);
 	// set up forward pointer
 	status = newPage->setNextPage(-1);
 	
 	 // set up header page pointers properly
 	hdrPage->recCnt = 0;
 	hdrPage->pageCnt = 1;
+	hdrPage->pageFlags = pageFlags;
+	hdrPage->recLen = recLen;
+	hdrPage->colCnt = pageFlags & PAX ? colCnt : 0;
+	for (int c = 0; c < hdrPage->colCnt; c++)
+	    hdrPage->colLen[c] = colLen[c];
+	for (int k = 0; k < FSMPAGES; k++)
+	{
+	    hdrPage->fsmPage[k] = -1;
+	    hdrPage->fsmMax[k] = 0;
+	}
+	hdrPage->vacuumNext = -1;
 	hdrPage->firstPage = hdrPage->lastPage = newPageNo;
 
 	// unpin the data page
@@ -70,16 +102,20 @@ const Status destroyHeapFile(const string fileName)
 	return (db.destroyFile (fileName));
 }
 
-// constructor opens the underlying file
-HeapFile::HeapFile(const string & fileName, Status& returnStatus)
+// constructor opens the underlying file; a file opened in MAPPED
+// mode can only be read
+HeapFile::HeapFile(const string & fileName, Status& returnStatus,
+                   const AccessMode mode)
 {
     Status 	status;
     Page*	pagePtr;
 
+    strategy = NULL;
+    recBuf = NULL;
     //cout << "opening file " << fileName << endl;
 
     // open the file and read in the header page and the first data page
-    if ((status = db.openFile(fileName, filePtr)) == OK)
+    if ((status = db.openFile(fileName, filePtr, mode)) == OK)
     {
 		//  get header page into the buffer pool
 		// first gets its page number
@@ -97,10 +133,12 @@ HeapFile::HeapFile(const string & fileName, Status& returnStatus)
 		}
 		headerPage = (FileHdrPage*) pagePtr;
 		hdrDirtyFlag = false;
+		if (headerPage->pageFlags & PAX)
+		    recBuf = new char[headerPage->recLen];
 
 		// next read the first data page into the buffer pool
 		curPageNo = headerPage->firstPage;
-		status = bufMgr->readPage(filePtr, curPageNo, curPage);
+		status = bufMgr->readPage(filePtr, curPageNo, curPage, strategy);
 		if (status != OK) 
 		{
 			cerr << "read of data page failed\n";
@@ -144,6 +182,8 @@ HeapFile::~HeapFile()
     // status = bufMgr->flushFile(filePtr);  // make sure all pages of the file are flushed to disk
     // if (status != OK) cerr << "error in flushFile call\n";
     // before close the file
+    delete strategy;
+    delete [] recBuf;
     status = db.closeFile(filePtr);
     if (status != OK)
     {
@@ -153,6 +193,229 @@ HeapFile::~HeapFile()
     }
 }
 
+// Record in the free-space map that page pageNo has freeBytes free.
+// The page of the map covering it is allocated if need be.
+
+const Status HeapFile::fsmUpdate(const int pageNo, const int freeBytes)
+{
+    Status status;
+    Page* page;
+    int k = pageNo / PAGESIZE;
+    int bucket = freeBytes / FSMUNIT;
+
+    if (k >= FSMPAGES) return OK;	// not covered by the map
+    if (headerPage->fsmPage[k] < 0)
+    {
+	if (bucket == 0) return OK;	// not in the map means full
+	int fsmPageNo;
+	status = bufMgr->allocPage(filePtr, fsmPageNo, page);
+	if (status != OK) return status;
+	memset(page, 0, PAGESIZE);
+	headerPage->fsmPage[k] = fsmPageNo;
+	hdrDirtyFlag = true;
+    }
+    else
+    {
+	status = bufMgr->readPage(filePtr, headerPage->fsmPage[k], page);
+	if (status != OK) return status;
+    }
+
+    unsigned char* map = (unsigned char*)page;
+    bool changed = map[pageNo % PAGESIZE] != bucket;
+    map[pageNo % PAGESIZE] = bucket;
+    if (bucket > headerPage->fsmMax[k])
+    {
+	headerPage->fsmMax[k] = bucket;
+	hdrDirtyFlag = true;
+    }
+    return bufMgr->unPinPage(filePtr, headerPage->fsmPage[k], changed);
+}
+
+// Find a page that the free-space map says has room for needed
+// bytes; pageNo is -1 if there is none. The bound kept for a page of
+// the map that turns out to have no such page is lowered to what it
+// has.
+
+const Status HeapFile::fsmFind(const int needed, int& pageNo)
+{
+    Status status;
+    Page* page;
+    int bucket = (needed + FSMUNIT - 1) / FSMUNIT;
+
+    pageNo = -1;
+    for (int k = 0; k < FSMPAGES; k++)
+    {
+	if (headerPage->fsmPage[k] < 0 || headerPage->fsmMax[k] < bucket)
+	    continue;
+	status = bufMgr->readPage(filePtr, headerPage->fsmPage[k], page);
+	if (status != OK) return status;
+
+	const unsigned char* map = (const unsigned char*)page;
+	int most = 0;
+	for (int i = 0; i < (int)PAGESIZE; i++)
+	{
+	    if (map[i] >= bucket)
+	    {
+		pageNo = k * PAGESIZE + i;
+		break;
+	    }
+	    if (map[i] > most)
+		most = map[i];
+	}
+	status = bufMgr->unPinPage(filePtr, headerPage->fsmPage[k], false);
+	if (status != OK || pageNo >= 0) return status;
+
+	headerPage->fsmMax[k] = most;
+	hdrDirtyFlag = true;
+    }
+    return OK;
+}
+
+// Compact the file: going down the page chain, move the records of
+// each page to earlier pages that have room, and unlink and dispose
+// of the pages that are emptied. A page whose records do not all fit
+// stays, with room for the records of the pages after it. Records
+// that are moved get new RIDs.
+//
+// With maxPages, only that many pages are gone through, so that a
+// vacuum of a large file can be done a step at a time between other
+// work; each step goes on from the page where the last one stopped,
+// and moves records only to that page and the ones it has gone
+// through itself. A file larger than the buffer pool is gone through
+// a ring of frames. Returns the # of pages gone through, records
+// moved and pages disposed of.
+
+const Status HeapFile::vacuum(const int maxPages, int & examined,
+                              int & moved, int & freed)
+{
+    Status status;
+    Page* page;
+    Page* target;
+    RID rid, newRid;
+    Record rec;
+    vector<int> targets;        // earlier pages with room, in order
+
+    examined = moved = freed = 0;
+    if (filePtr->isMapped()) return FILEREADONLY;
+
+    // the scan's page is let go of, as it may be disposed of
+    if (curPage != NULL)
+    {
+        status = bufMgr->unPinPage(filePtr, curPageNo, curDirtyFlag);
+        curPage = NULL;
+        if (status != OK) return status;
+    }
+    curPageNo = -1;
+    curRec = NULLRID;
+    if (!strategy && headerPage->pageCnt > bufMgr->numFrames())
+        strategy = new BufStrategy(BULKWRITE);
+
+    // start after the page the last step stopped at, if still there
+    int prevPageNo = headerPage->vacuumNext;
+    int pageNo = headerPage->firstPage;
+    if (prevPageNo >= 0 && filePtr->isAllocated(prevPageNo))
+    {
+        if ((status = bufMgr->readPage(filePtr, prevPageNo, page)) != OK)
+            return status;
+        page->getNextPage(pageNo);
+        status = bufMgr->unPinPage(filePtr, prevPageNo, false);
+        if (status != OK) return status;
+        targets.push_back(prevPageNo);
+    }
+    else
+        prevPageNo = -1;
+
+    while (pageNo != -1 && (maxPages == 0 || examined < maxPages))
+    {
+        int nextPageNo;
+        status = bufMgr->readPage(filePtr, pageNo, page, strategy);
+        if (status != OK) return status;
+        page->getNextPage(nextPageNo);
+        examined++;
+
+        // move the records of the page, first to last, while they fit
+        bool dirty = false;
+        while (page->firstRecord(rid) == OK && !targets.empty())
+        {
+            if ((status = page->getRecord(rid, rec, recBuf)) != OK)
+                break;
+            int targetNo = targets.front();
+            status = bufMgr->readPage(filePtr, targetNo, target);
+            if (status != OK) break;
+            int freeBefore = target->getFreeSpace();
+            status = target->insertRecord(rec, newRid);
+            int freeAfter = target->getFreeSpace();
+            Status unpin = bufMgr->unPinPage(filePtr, targetNo, status == OK);
+            if (unpin != OK) { status = unpin; break; }
+            if (status == NOSPACE)
+            {
+                // full, on to the next page with room
+                targets.erase(targets.begin());
+                status = OK;
+                continue;
+            }
+            if (status != OK) break;
+            if (freeAfter / FSMUNIT != freeBefore / FSMUNIT
+                && (status = fsmUpdate(targetNo, freeAfter)) != OK)
+                break;
+            if ((status = page->deleteRecord(rid)) != OK) break;
+            dirty = true;
+            moved++;
+        }
+        if (status != OK)
+        {
+            bufMgr->unPinPage(filePtr, pageNo, dirty);
+            return status;
+        }
+
+        // keep a page that still has records, or the only one left
+        RID first;
+        if (page->firstRecord(first) == OK
+            || (prevPageNo == -1 && nextPageNo == -1))
+        {
+            int freeSpace = page->getFreeSpace();
+            status = bufMgr->unPinPage(filePtr, pageNo, dirty);
+            if (status != OK) return status;
+            if ((status = fsmUpdate(pageNo, freeSpace)) != OK)
+                return status;
+            targets.push_back(pageNo);
+            prevPageNo = pageNo;
+            pageNo = nextPageNo;
+            continue;
+        }
+
+        // unlink the empty page from the chain
+        status = bufMgr->unPinPage(filePtr, pageNo, dirty);
+        if (status != OK) return status;
+        if (prevPageNo == -1)
+            headerPage->firstPage = nextPageNo;
+        else
+        {
+            if ((status = bufMgr->readPage(filePtr, prevPageNo, page)) != OK)
+                return status;
+            page->setNextPage(nextPageNo);
+            status = bufMgr->unPinPage(filePtr, prevPageNo, true);
+            if (status != OK) return status;
+        }
+        if (headerPage->lastPage == pageNo)
+            headerPage->lastPage = prevPageNo;
+        headerPage->pageCnt--;
+        hdrDirtyFlag = true;
+
+        // and give its space back to the file
+        if ((status = fsmUpdate(pageNo, 0)) != OK) return status;
+        if ((status = bufMgr->disposePage(filePtr, pageNo)) != OK)
+            return status;
+        freed++;
+        pageNo = nextPageNo;
+    }
+
+    // the next step goes on from here, or from the start
+    headerPage->vacuumNext = pageNo == -1 ? -1 : prevPageNo;
+    hdrDirtyFlag = true;
+    return OK;
+}
+
 // Return number of records in heap file
 
 const int HeapFile::getRecCnt() const
@@ -176,7 +439,7 @@ const Status HeapFile::getRecord(const RID &  rid, Record & rec)
         if (rid.pageNo == curPageNo)
         {
 			// already have correct page pinned
-			status = curPage->getRecord(rid, rec);
+			status = curPage->getRecord(rid, rec, recBuf);
 			curRec = rid;
 			return status;
         }
@@ -191,28 +454,41 @@ const Status HeapFile::getRecord(const RID &  rid, Record & rec)
 			}
         }
     }
-    status = bufMgr->readPage(filePtr, rid.pageNo, curPage);
+    status = bufMgr->readPage(filePtr, rid.pageNo, curPage, strategy);
     if (status != OK) return status;
     curPageNo = rid.pageNo;
     curDirtyFlag = false;
     curRec = rid;
 
     // get the record
-    return curPage->getRecord(rid, rec);
+    return curPage->getRecord(rid, rec, recBuf);
 }
 
+int HeapFileScan::readAheadMax = READAHEADMAX;
+
 HeapFileScan::HeapFileScan(const string & name,
-			   Status & status) : HeapFile(name, status)
+			   Status & status,
+			   const AccessMode mode) : HeapFile(name, status, mode)
 {
     filter = NULL;
+    raWindow = raNext = 0;
 }
 
 const Status HeapFileScan::startScan(const int offset_,
 				     const int length_,
 				     const Datatype type_, 
 				     const char* filter_,
-				     const Operator op_)
+				     const Operator op_,
+				     const bool noCache)
 {
+    // the scan reads the file front to back
+    filePtr->advise(0, 0, SEQACCESS);
+
+    // keep a large or temporary file from taking over the pool
+    if (!strategy && (noCache || headerPage->pageCnt > bufMgr->numFrames()))
+        strategy = new BufStrategy(noCache ? NOCACHE : BULKREAD);
+    raWindow = raNext = 0;
+
     if (!filter_) {                        // no filtering requested
         filter = NULL;
         return OK;
@@ -237,6 +513,50 @@ const Status HeapFileScan::startScan(const int offset_,
 }
 
 
+// The scan moves on from page prevPageNo to nextPageNo. Heap files
+// grow at the end, so the page chain mostly runs in page number
+// order; as long as it does, keep the next raWindow pages of the
+// file prefetched. The window starts small, so a scan that stops
+// after a few pages or jumps about reads little it does not need,
+// and grows up to readAheadMax. A scan through a ring reads ahead
+// at most half the ring, so that a prefetched page is used before
+// its slot is reused. Prefetching is only a hint; if it fails, the
+// page is read when the scan gets to it.
+
+void HeapFileScan::readAhead(const int prevPageNo, const int nextPageNo)
+{
+    int limit = readAheadMax;
+    if (limit > bufMgr->numFrames() / 4)
+        limit = bufMgr->numFrames() / 4;
+    if (strategy && limit > bufMgr->ringSize(strategy) / 2)
+        limit = bufMgr->ringSize(strategy) / 2;
+
+    // a step over a map page or a disposed page is still sequential;
+    // the OS reads ahead in mapped files by itself
+    if (limit < 1 || filePtr->isMapped() || nextPageNo <= prevPageNo
+        || nextPageNo > prevPageNo + 2)
+    {
+        raWindow = raNext = 0;
+        return;
+    }
+
+    if (raWindow == 0 || raNext <= nextPageNo)
+    {
+        raWindow = READAHEADMIN < limit ? READAHEADMIN : limit;
+        raNext = nextPageNo + 1;
+    }
+    else if (raNext - nextPageNo > raWindow / 2)
+        return;                         // enough still ahead
+    else if (raWindow < limit)
+        raWindow = 2 * raWindow < limit ? 2 * raWindow : limit;
+
+    for (; raNext <= nextPageNo + raWindow; raNext++)
+        if (filePtr->isAllocated(raNext)
+            && bufMgr->prefetchPage(filePtr, raNext, strategy) != OK)
+            break;
+}
+
+
 const Status HeapFileScan::endScan()
 {
     Status status;
@@ -247,6 +567,7 @@ const Status HeapFileScan::endScan()
         curPage = NULL;
         curPageNo = 0;
 		curDirtyFlag = false;
+        filePtr->advise(0, 0, NORMALACCESS);
         return status;
     }
     return OK;
@@ -277,9 +598,10 @@ const Status HeapFileScan::resetScan()
 		}
 		// restore curPageNo and curRec values
 		curPageNo = markedPageNo;
+		raWindow = raNext = 0;
 		curRec = markedRec;
 		// then read the page
-		status = bufMgr->readPage(filePtr, curPageNo, curPage);
+		status = bufMgr->readPage(filePtr, curPageNo, curPage, strategy);
 		if (status != OK) return status;
 		curDirtyFlag = false; // it will be clean
     }
@@ -294,7 +616,6 @@ const Status HeapFileScan::scanNext(RID& outRid)
     RID		nextRid;
     RID		tmpRid;
     int 	nextPageNo;
-    Record      rec;
 
     if (curPageNo < 0) return FILEEOF;  // already at EOF!
 
@@ -306,7 +627,7 @@ const Status HeapFileScan::scanNext(RID& outRid)
 		if (curPageNo == -1) return FILEEOF; // file is empty
 	 
 		// read the first page of the file
-        status = bufMgr->readPage(filePtr, curPageNo, curPage); 
+        status = bufMgr->readPage(filePtr, curPageNo, curPage, strategy); 
 		curDirtyFlag = false;
 		curRec = NULLRID;
         if (status != OK) return status;
@@ -324,11 +645,8 @@ const Status HeapFileScan::scanNext(RID& outRid)
 				curPage = NULL; // for endScan()
 				return FILEEOF;  // first page had no records
 			}
-			// get pointer to record
-			status = curPage->getRecord(tmpRid, rec);
-			if (status != OK) return status;
 			// see if record matches predicate
-            if (matchRec(rec) == true)  
+            if (matchRec(tmpRid) == true)  
 			{
 				outRid = tmpRid;
 				return OK;
@@ -351,7 +669,9 @@ const Status HeapFileScan::scanNext(RID& outRid)
 			status = curPage->getNextPage(nextPageNo);
 			if (nextPageNo == -1) return FILEEOF; // end of file
 
-			// unpin the current page
+			// start reading the pages after it, then unpin the
+			// current page
+			readAhead(curPageNo, nextPageNo);
     	    status = bufMgr->unPinPage(filePtr,curPageNo, curDirtyFlag);
 			curPage = NULL;  curPageNo = -1;
 			if (status != OK) return status;
@@ -361,7 +681,7 @@ const Status HeapFileScan::scanNext(RID& outRid)
 			curDirtyFlag = false;
 
 			// read the next page of the file
-            status = bufMgr->readPage(filePtr,curPageNo,curPage);
+            status = bufMgr->readPage(filePtr,curPageNo,curPage,strategy);
             if (status != OK) return status;
 
 			// get the first record off the page
@@ -370,11 +690,7 @@ const Status HeapFileScan::scanNext(RID& outRid)
 		
 		// curRec points at a valid record
 		// see if the record satisfies the scan's predicate 
-		// get a pointer to the record
-		status = curPage->getRecord(curRec, rec);
-		if (status != OK) return status;
-		// see if record matches predicate
-		if (matchRec(rec) == true)  
+		if (matchRec(curRec) == true)  
 		{
 			// return rid of the record
 			outRid = curRec;
@@ -389,7 +705,20 @@ const Status HeapFileScan::scanNext(RID& outRid)
 
 const Status HeapFileScan::getRecord(Record & rec)
 {
-    return curPage->getRecord(curRec, rec);
+    return curPage->getRecord(curRec, rec, recBuf);
+}
+
+// copies a field of the current record, which of a PAX file is
+// read from the minipage of its column alone
+
+const Status HeapFileScan::getField(const int offset, const int length,
+                                    char* field)
+{
+    const char* value;
+    Status status = curPage->getField(curRec, offset, length, value);
+    if (status != OK) return status;
+    memcpy(field, value, length);
+    return OK;
 }
 
 // delete record from file. 
@@ -397,13 +726,21 @@ const Status HeapFileScan::deleteRecord()
 {
     Status status;
 
+    if (filePtr->isMapped()) return FILEREADONLY;
+
     // delete the "current" record from the page
+    int freeBefore = curPage->getFreeSpace();
     status = curPage->deleteRecord(curRec);
     curDirtyFlag = true;
 
     // reduce count of number of records in the file
     headerPage->recCnt--;
     hdrDirtyFlag = true; 
+
+    // let inserts find the room, once it is a unit more
+    if (status == OK
+        && curPage->getFreeSpace() / FSMUNIT != freeBefore / FSMUNIT)
+        status = fsmUpdate(curPageNo, curPage->getFreeSpace());
     return status;
 }
 
@@ -411,18 +748,25 @@ const Status HeapFileScan::deleteRecord()
 // mark current page of scan dirty
 const Status HeapFileScan::markDirty()
 {
+    if (filePtr->isMapped()) return FILEREADONLY;
     curDirtyFlag = true;
     return OK;
 }
 
-const bool HeapFileScan::matchRec(const Record & rec) const
+// Only the filter attribute of the record is looked at, which on a
+// PAX page is in the minipage of its column, next to the same
+// attribute of the records that the scan tests before and after.
+
+const bool HeapFileScan::matchRec(const RID & rid) const
 {
     // no filtering requested
     if (!filter) return true;
 
-    // see if offset + length is beyond end of record
+    // get the attribute; no match if offset + length is beyond end
+    // of record
     // maybe this should be an error???
-    if ((offset + length -1 ) >= rec.length)
+    const char* attr;
+    if (curPage->getField(rid, offset, length, attr) != OK)
 	return false;
 
     float diff = 0;                       // < 0 if attr < fltr
@@ -431,7 +775,7 @@ const bool HeapFileScan::matchRec(const Record & rec) const
     case INTEGER:
         int iattr, ifltr;                 // word-alignment problem possible
         memcpy(&iattr,
-               (char *)rec.data + offset,
+               attr,
                length);
         memcpy(&ifltr,
                filter,
@@ -442,7 +786,7 @@ const bool HeapFileScan::matchRec(const Record & rec) const
     case FLOAT:
         float fattr, ffltr;               // word-alignment problem possible
         memcpy(&fattr,
-               (char *)rec.data + offset,
+               attr,
                length);
         memcpy(&ffltr,
                filter,
@@ -451,7 +795,7 @@ const bool HeapFileScan::matchRec(const Record & rec) const
         break;
 
     case STRING:
-        diff = strncmp((char *)rec.data + offset,
+        diff = strncmp(attr,
                        filter,
                        length);
         break;
@@ -470,8 +814,11 @@ const bool HeapFileScan::matchRec(const Record & rec) const
 }
 
 InsertFileScan::InsertFileScan(const string & name,
-                               Status & status) : HeapFile(name, status)
+                               Status & status,
+                               const bool noCache) : HeapFile(name, status)
 {
+  strategy = new BufStrategy(noCache ? NOCACHE : BULKWRITE);
+
   // Heapfile constructor will read the header page and the first
   // data page of the file into the buffer pool
   // if the first data page of the file is not the last data page of the file
@@ -481,7 +828,7 @@ InsertFileScan::InsertFileScan(const string & name,
         status = bufMgr->unPinPage(filePtr, curPageNo, curDirtyFlag);
         if (status != OK) cerr << "error in unpin of data page\n"; 
     	curPageNo = headerPage->lastPage;
-    	status = bufMgr->readPage(filePtr, curPageNo, curPage);
+    	status = bufMgr->readPage(filePtr, curPageNo, curPage, strategy);
         if (status != OK) cerr << "error in readPage \n"; 
 	curDirtyFlag = false;
   }
@@ -490,10 +837,13 @@ InsertFileScan::InsertFileScan(const string & name,
 InsertFileScan::~InsertFileScan()
 {
     Status status;
-    // unpin last page of the scan
+    // unpin last page of the scan, after recording the room it has
+    // left
     if (curPage != NULL)
     {
 	//cout << "executing insertfilescan destructor. unpinning page " << curPageNo << endl;
+        status = fsmUpdate(curPageNo, curPage->getFreeSpace());
+        if (status != OK) cerr << "error in update of free-space map\n";
         status = bufMgr->unPinPage(filePtr, curPageNo, true);
         curPage = NULL;
         curPageNo = 0;
@@ -510,23 +860,56 @@ const Status InsertFileScan::insertRecord(const Record & rec, RID& outRid)
     RID		rid;
 
     // check for very large records
-    if ((unsigned int) rec.length > PAGESIZE-DPFIXED)
+    if ((unsigned int) rec.length > Page::maxRecLen(headerPage->pageFlags))
     {
         // will never fit on a page, so don't even bother looking
         return INVALIDRECLEN;
     }
+    if ((headerPage->pageFlags & FIXEDREC) && rec.length != headerPage->recLen)
+	return INVALIDRECLEN;
 
     if (curPage == NULL)
     {
 	// make the last page the current page and read it from disk
     	curPageNo = headerPage->lastPage;
-    	status = bufMgr->readPage(filePtr, curPageNo, curPage);
+    	status = bufMgr->readPage(filePtr, curPageNo, curPage, strategy);
     	if (status != OK) return status;
     }
 
     // cout << "insertRecord.  curPageNo is " << curPageNo << endl;
     // try and add the record onto the current page. 
     status = curPage->insertRecord(rec, rid);
+    while (status == NOSPACE)
+    {
+	// current page was full. record the room it has left, and try
+	// a page the free-space map says has room for the record
+	int needed = rec.length;
+	if (!(headerPage->pageFlags & FIXEDREC))
+	    needed += sizeof(slot_t);
+	status = fsmUpdate(curPageNo, curPage->getFreeSpace());
+	if (status != OK) return status;
+	status = fsmFind(needed, newPageNo);
+	if (status != OK) return status;
+	if (newPageNo < 0)
+	{
+	    status = NOSPACE;
+	    break;
+	}
+
+	status = bufMgr->unPinPage(filePtr, curPageNo, curDirtyFlag);
+	curPage = NULL;
+	if (status != OK) return status;
+	curPageNo = newPageNo;
+	curDirtyFlag = false;
+	status = bufMgr->readPage(filePtr, curPageNo, curPage, strategy);
+	if (status != OK)
+	{
+	    curPage = NULL;
+	    return status;
+	}
+	status = curPage->insertRecord(rec, rid);
+    }
+
     if (status == OK)
     {
     	headerPage->recCnt++;
@@ -535,15 +918,33 @@ const Status InsertFileScan::insertRecord(const Record & rec, RID& outRid)
         curDirtyFlag = true;  // page is dirty
 	return status;
     }
+    else if (status != NOSPACE) return status;
     else
     {
-	// current page was full.  allocate a new page
-	status = bufMgr->allocPage(filePtr, newPageNo, newPage);
+	// no page has room. new pages go after the last page
+	if (curPageNo != headerPage->lastPage)
+	{
+	    status = bufMgr->unPinPage(filePtr, curPageNo, curDirtyFlag);
+	    curPage = NULL;
+	    if (status != OK) return status;
+	    curPageNo = headerPage->lastPage;
+	    curDirtyFlag = false;
+	    status = bufMgr->readPage(filePtr, curPageNo, curPage, strategy);
+	    if (status != OK)
+	    {
+		curPage = NULL;
+		return status;
+	    }
+	}
+
+	// allocate a new page
+	status = bufMgr->allocPage(filePtr, newPageNo, newPage, strategy);
 	if (status != OK) return status;
 	// cout << "insertRecord.  page was full. got new page " << newPageNo << endl;
 
 	// initialize the empty page
-	newPage->init(newPageNo);
+	newPage->init(newPageNo, headerPage->pageFlags, headerPage->recLen,
+		      headerPage->colCnt, headerPage->colLen);
 	status = newPage->setNextPage(-1); // no next page
 	if (status != OK) return status;
 
@@ -15,15 +15,34 @@ using namespace std;
 
 extern DB db;
 
+// access mode of the scans of read-only queries (select, join, print)
+extern AccessMode ScanMode;
+
 // define if debug output wanted
 //#define DEBUGREL
 
 // Some constant definitions
 const unsigned MAXNAMESIZE = 50;
 
+// read-ahead window of a scan, in pages, when it starts and at most
+const int READAHEADMIN = 4;
+const int READAHEADMAX = 32;
+
 enum Datatype { STRING, INTEGER, FLOAT };    // attribute data types
 enum Operator { LT, LTE, EQ, GTE, GT, NE };  // scan operators
 
+// A heap file keeps a free-space map: a byte for each page, in up to
+// FSMPAGES pages of its own that are allocated as needed, each of
+// which covers PAGESIZE pages by page #. The byte of a data page is
+// the free space the page had when it was last looked at, in units of
+// FSMUNIT bytes, rounded down; pages the map does not cover are only
+// ever appended to. The header page keeps the page #s of the map's
+// pages and for each an upper bound on its bytes, so that a search
+// skips the pages of the map without room.
+
+const int FSMPAGES = 32;
+#define FSMUNIT (PAGESIZE / 256)
+
 struct FileHdrPage
 {
   char		fileName[MAXNAMESIZE];   // name of file
@@ -31,6 +50,14 @@ struct FileHdrPage
   int		lastPage;	// pageNo of last data page in file
   int		pageCnt;	// number of pages
   int		recCnt;		// record count
+  int		pageFlags;	// flags data pages are initialized with
+  int		recLen;		// record length, with FIXEDREC
+  short		colCnt;		// # of columns, with PAX
+  short		colLen[MAXCOLUMNS];	// widths of the columns, with PAX
+  int		fsmPage[FSMPAGES];	// pages of free-space map, -1 if none
+  unsigned char	fsmMax[FSMPAGES];	// most free of the pages covered
+  int		vacuumNext;	// page an incremental vacuum goes on
+				// after, -1 to start at first page
 };
 
 
@@ -46,11 +73,18 @@ protected:
    int   	curPageNo;	// page number of pinned page
    bool  	curDirtyFlag;   // true if page has been updated
    RID   	curRec;         // rid of last record returned
+   BufStrategy* strategy;       // ring for bulk access, or NULL
+   char*	recBuf;		// record gathered from a PAX page
+
+   // free-space map
+   const Status fsmUpdate(const int pageNo, const int freeBytes);
+   const Status fsmFind(const int needed, int& pageNo);
 
 public:
 
   // initialize
-  HeapFile(const string & name, Status& returnStatus);
+  HeapFile(const string & name, Status& returnStatus,
+           const AccessMode mode = READWRITE);
 
   // destructor
   ~HeapFile();
@@ -60,6 +94,12 @@ public:
 
   // given a RID, read record from file, returning pointer and length
   const Status getRecord(const RID &rid, Record & rec);
+
+  // move records to earlier pages with room and dispose of the pages
+  // emptied, going through at most maxPages pages (all if 0) from
+  // where the last vacuum stopped
+  const Status vacuum(const int maxPages, int & examined, int & moved,
+                      int & freed);
 };
 
 
@@ -67,16 +107,21 @@ class HeapFileScan : public HeapFile
 {
 public:
 
-    HeapFileScan(const string & name, Status & status);
+    HeapFileScan(const string & name, Status & status,
+                 const AccessMode mode = READWRITE);
 
     // end filtered scan
     ~HeapFileScan();
 
+    // A file larger than the buffer pool is read through a small
+    // ring of frames; noCache does so for any file, for temporary
+    // files that should not stay in the pool
     const Status startScan(const int offset, 
                            const int length,  
                            const Datatype type, 
                            const char* filter, 
-                           const Operator op);
+                           const Operator op,
+                           const bool noCache = false);
 
     const Status endScan(); // terminate the scan
     const Status markScan(); // save current position of scan
@@ -88,12 +133,20 @@ public:
     // read current record, returning pointer and length
     const Status getRecord(Record & rec);
 
+    // copy the length bytes at offset of the current record to
+    // field; of a PAX file, only that column is read
+    const Status getField(const int offset, const int length, char* field);
+
     // delete current record 
     const Status deleteRecord();
 
     // marks current page of scan dirty
     const Status markDirty();
 
+    // max. # of pages a scan reads ahead of the page it is on; 0
+    // turns read-ahead off
+    static int readAheadMax;
+
 private:
     int   offset;            // byte offset of filter attribute
     int   length;            // length of filter attribute
@@ -108,7 +161,14 @@ private:
     int   markedPageNo;	// page number of pinned page
     RID   markedRec;         // rid of last record returned
 
-    const bool matchRec(const Record & rec) const;
+    // While the scan steps from page to page in page number order,
+    // the pages after the current one are prefetched; the window
+    // doubles each time the scan has used up half of it.
+    int   raWindow;          // # of pages to keep read ahead, 0 if none
+    int   raNext;            // next page number to prefetch
+
+    void readAhead(const int prevPageNo, const int nextPageNo);
+    const bool matchRec(const RID & rid) const;
 };
 
 
@@ -116,7 +176,10 @@ class InsertFileScan : public HeapFile
 {
 public:
 
-    InsertFileScan(const string & name, Status & status);
+    // pages are written through a small ring of frames; noCache is
+    // for temporary files, whose pages should not stay in the pool
+    InsertFileScan(const string & name, Status & status,
+                   const bool noCache = false);
 
     // end filtered scan
     ~InsertFileScan();
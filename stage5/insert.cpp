@@ -2,6 +2,15 @@
 #include "query.h"
 
 
+// # of inserts made durable together by one group-commit barrier
+
+static const int INSERTBATCH = 64;
+
+// # of inserts since the last barrier
+
+static int unsynced = 0;
+
+
 /*
  * Inserts a record into the specified relation.
  * The value of the attribute is supplied in the attrValue member of the attrInfo structure.
@@ -15,7 +24,7 @@
  * an error code otherwise
  */
 
-const Status QU_Insert(const string & relation,
+static const Status insertTuple(const string & relation,
         const int attrCnt,
         const attrInfo attrList[])
 {
@@ -74,10 +83,28 @@ const Status QU_Insert(const string & relation,
 
     RID outRID;
     //Done creating record, inserting it into table
-    status = resultRel.insertRecord(outputRec, outRID);
-    if (status != OK) { return status; }
-    //if reached tuple inserted with no issues
-    return OK;
+    return resultRel.insertRecord(outputRec, outRID);
+}
 
+
+/*
+ * Inserts the tuple, then every INSERTBATCH inserts makes the
+ * inserted tuples durable with one group-commit barrier. The barrier
+ * runs once insertTuple has closed its scan, so the pages it wrote
+ * are unpinned and dirty; tuples of an unfinished batch are made
+ * durable by a checkpoint or when minirel quits.
+ * @return: OK on success
+ * an error code otherwise
+ */
+
+const Status QU_Insert(const string & relation,
+        const int attrCnt,
+        const attrInfo attrList[])
+{
+    Status status = insertTuple(relation, attrCnt, attrList);
+    if (status != OK) { return status; }
+    if (++unsynced < INSERTBATCH) { return OK; }
+    unsynced = 0;
+    return bufMgr->flushAll(true);
 }
 
@@ -0,0 +1,1483 @@
+//
+// iobench: micro benchmarks for the storage layer.
+//
+// Usage: iobench [pages [pagesize]]
+//
+// Builds a scratch file of the given number of pages (default 100000,
+// of the default page size unless another one is given)
+// in the current directory and reports pages/sec and system calls per
+// page for the I/O paths of the File class, including durable flushes
+// and random reads at increasing queue depths through the
+// asynchronous interface, and the flush of a small file from a
+// pool of up to 1M frames, and growing and shrinking such a pool.
+// The page table of the buffer manager is timed on its own, then 1
+// to 16 threads fetch pages through one buffer manager and the hit
+// ratios of the replacement policies are compared on a few reference
+// strings, as is a large scan with and without a ring of its own; a
+// pool is resized while in use, a hot set is fetched after a cold
+// and a warm start, and random updates and a load are run with and
+// without the background writer. Finally a heap file with as many
+// records is used to compare buffered and direct I/O, and one with
+// ten times as many is scanned cold with growing read-ahead windows,
+// and a relation of wide tuples, laid out by rows and as PAX, is
+// scanned warm with a selective filter. Last, half the records of a
+// relation are deleted and as many inserted, round after round, and
+// a relation that nine in ten records were deleted from is vacuumed.
+//
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <iostream>
+#include "page.h"
+#include "buf.h"
+#include "catalog.h"
+
+#define CALL(c)    { Status s; \
+                     if ((s = c) != OK) { \
+		       cerr << "At line " << __LINE__ << ":" << endl << "  "; \
+                       error.print(s); \
+                       exit(1); \
+                     } \
+                   }
+
+#define BENCHFILE  "iobench.db"
+#define BENCHREL   "iobench.rel"
+#define MTFILE     "iobench.mt"
+#define RECLEN     100
+#define PAXREL     "iobench.pax"
+
+BufMgr*     bufMgr = NULL;
+DB          db;
+Error       error;
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void report(const char* name, int pages, long syscalls, double secs,
+		   const char* unit = "page")
+{
+  printf("%-28s %8d %ss %10.0f %ss/sec %8.4f syscalls/%s\n",
+	 name, pages, unit, pages / secs, unit, (double)syscalls / pages, unit);
+}
+
+// Page number sequence used by the random read tests. Page 0 is the
+// DB header page and is never touched.
+
+static int* randomPages(int pages)
+{
+  int* order = new int[pages - 1];
+  for (int i = 0; i < pages - 1; i++)
+    order[i] = i + 1;
+  srand(564);
+  for (int i = pages - 2; i > 0; i--) {
+    int j = rand() % (i + 1);
+    int tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+  }
+  return order;
+}
+
+// The pre-pread I/O path: seek to the page, then read or write it.
+
+static void benchSeek(int pages, const int* order, bool doWrite)
+{
+  char page[PAGESIZE];
+  int fd;
+  if ((fd = open(BENCHFILE, O_RDWR)) < 0) {
+    perror("open");
+    exit(1);
+  }
+
+  long syscalls = 0;
+  double start = now();
+  for (int i = 0; i < pages - 1; i++) {
+    int pageNo = order ? order[i] : i + 1;
+    lseek(fd, (off_t)pageNo * PAGESIZE, SEEK_SET);
+    if (doWrite)
+      (void)write(fd, page, PAGESIZE);
+    else
+      (void)read(fd, page, PAGESIZE);
+    syscalls += 2;
+  }
+  report(doWrite ? "lseek+write" : (order ? "lseek+read random" : "lseek+read seq"),
+	 pages - 1, syscalls, now() - start);
+  close(fd);
+}
+
+// The File class path (positional I/O).
+
+static void benchFile(File* file, int pages, const int* order, bool doWrite)
+{
+  char buf[PAGESIZE];
+  Page* page = (Page*)buf;
+  memset(buf, 0, PAGESIZE);
+
+  file->clearIOStats();
+  double start = now();
+  for (int i = 0; i < pages - 1; i++) {
+    int pageNo = order ? order[i] : i + 1;
+    if (doWrite)
+      CALL(file->writePage(pageNo, page))
+    else
+      CALL(file->readPage(pageNo, page))
+  }
+  const IOStats & stats = file->getIOStats();
+  report(doWrite ? "File::writePage" : (order ? "File::readPage random" : "File::readPage seq"),
+	 pages - 1, stats.reads + stats.writes, now() - start);
+}
+
+// Sequential read of the whole file in runs of batch pages with
+// File::readPages.
+
+static void benchReadPages(File* file, int pages, int batch)
+{
+  char* buf = new char[batch * PAGESIZE];
+  Page** dest = new Page* [batch];
+  for (int i = 0; i < batch; i++)
+    dest[i] = (Page*)(buf + i * PAGESIZE);
+
+  file->clearIOStats();
+  double start = now();
+  for (int pageNo = 1; pageNo < pages; pageNo += batch) {
+    int count = pages - pageNo < batch ? pages - pageNo : batch;
+    CALL(file->readPages(pageNo, count, dest));
+  }
+  const IOStats & stats = file->getIOStats();
+  report("File::readPages seq", pages - 1, stats.reads, now() - start);
+
+  delete [] dest;
+  delete [] buf;
+}
+
+// Dirty every frame of a buffer pool with freshly allocated pages of
+// a temporary file and time BufMgr::flushFile.
+
+static void benchFlush(int frames)
+{
+  const char* tmpName = BENCHFILE ".tmp";
+  File* tmp;
+  Page* page;
+  int pageNo;
+
+  bufMgr = new BufMgr(frames);
+  (void)db.destroyFile(tmpName);
+  CALL(db.createFile(tmpName));
+  CALL(db.openFile(tmpName, tmp));
+
+  for (int i = 0; i < frames; i++) {
+    CALL(bufMgr->allocPage(tmp, pageNo, page));
+    page->init(pageNo);
+    CALL(bufMgr->unPinPage(tmp, pageNo, true));
+  }
+
+  tmp->clearIOStats();
+  double start = now();
+  CALL(bufMgr->flushFile(tmp));
+  const IOStats & stats = tmp->getIOStats();
+  report("BufMgr::flushFile", frames, stats.writes, now() - start);
+
+  CALL(db.closeFile(tmp));
+  CALL(db.destroyFile(tmpName));
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+// Time growing an empty pool of 1000 frames to the given size and
+// shrinking it back, which maps and releases the chunks of frames.
+
+static void benchGrow(int frames, int rounds)
+{
+  double growSecs = 0, shrinkSecs = 0;
+
+  bufMgr = new BufMgr(1000);
+  for (int r = 0; r < rounds; r++) {
+    double start = now();
+    CALL(bufMgr->resize(frames));
+    growSecs += now() - start;
+    start = now();
+    CALL(bufMgr->resize(1000));
+    shrinkSecs += now() - start;
+  }
+  printf("%-28s %8d frames %8.3f ms grow %8.3f ms shrink\n",
+	 "resize empty pool", frames, growSecs * 1e3 / rounds,
+	 shrinkSecs * 1e3 / rounds);
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+// Time BufMgr::flushFile of a small temporary file of 8 dirty pages
+// in a large buffer pool, as sorts and joins leave them.
+
+static void benchSmallFlush(int frames, int rounds)
+{
+  const char* tmpName = BENCHFILE ".tmp";
+  File* tmp;
+  Page* page;
+  int pageNo;
+  double secs = 0;
+  long writes = 0;
+
+  bufMgr = new BufMgr(frames);
+  (void)db.destroyFile(tmpName);
+  CALL(db.createFile(tmpName));
+  CALL(db.openFile(tmpName, tmp));
+
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 8; i++) {
+      CALL(bufMgr->allocPage(tmp, pageNo, page));
+      page->init(pageNo);
+      CALL(bufMgr->unPinPage(tmp, pageNo, true));
+    }
+    tmp->clearIOStats();
+    double start = now();
+    CALL(bufMgr->flushFile(tmp));
+    secs += now() - start;
+    writes += tmp->getIOStats().writes;
+  }
+
+  char name[40];
+  sprintf(name, "flushFile 8 of %d frames", frames);
+  report(name, rounds, writes, secs, "file");
+
+  CALL(db.closeFile(tmp));
+  CALL(db.destroyFile(tmpName));
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+// Dirty a buffer pool with pages of several temporary files and
+// make them durable with BufMgr::flushAll(true): one batch of sorted
+// writes and one group of fdatasyncs.
+
+static void benchSync(int frames, int numFiles)
+{
+  File* files[numFiles];
+  char name[40];
+  Page* page;
+  int pageNo;
+
+  bufMgr = new BufMgr(frames);
+  for (int f = 0; f < numFiles; f++) {
+    sprintf(name, BENCHFILE ".%d", f);
+    (void)db.destroyFile(name);
+    CALL(db.createFile(name));
+    CALL(db.openFile(name, files[f]));
+  }
+  CALL(DB::syncFiles());
+
+  for (int i = 0; i < frames; i++) {
+    File* file = files[i % numFiles];
+    CALL(bufMgr->allocPage(file, pageNo, page));
+    page->init(pageNo);
+    CALL(bufMgr->unPinPage(file, pageNo, true));
+  }
+
+  for (int f = 0; f < numFiles; f++)
+    files[f]->clearIOStats();
+  double start = now();
+  CALL(bufMgr->flushAll(true));
+  double secs = now() - start;
+  long syscalls = 0;
+  int syncs = 0;
+  for (int f = 0; f < numFiles; f++) {
+    syscalls += files[f]->getIOStats().writes + files[f]->getIOStats().syncs;
+    syncs += files[f]->getIOStats().syncs;
+  }
+  sprintf(name, "BufMgr::flushAll sync %d", syncs);
+  report(name, frames, syscalls, secs);
+
+  for (int f = 0; f < numFiles; f++) {
+    CALL(db.closeFile(files[f]));
+    sprintf(name, BENCHFILE ".%d", f);
+    CALL(db.destroyFile(name));
+  }
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+// Sequential scan of the whole file through a 100 frame buffer pool,
+// with the file either read into the pool or mapped.
+
+static void benchScan(int pages, const AccessMode mode)
+{
+  File* file;
+  Page* page;
+  long sum = 0;
+
+  bufMgr = new BufMgr(100);
+  CALL(db.openFile(BENCHFILE, file, mode));
+  CALL(file->advise(0, 0, SEQACCESS));
+
+  file->clearIOStats();
+  double start = now();
+  for (int pageNo = 1; pageNo < pages; pageNo++) {
+    CALL(bufMgr->readPage(file, pageNo, page));
+    sum += ((char*)page)[pageNo % PAGESIZE];
+    CALL(bufMgr->unPinPage(file, pageNo, false));
+  }
+  const IOStats & stats = file->getIOStats();
+  report(file->isMapped() ? "BufMgr::readPage mapped" : "BufMgr::readPage copied",
+	 pages - 1, stats.reads, now() - start);
+
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+// Open and close the scratch file repeatedly, with the descriptor
+// cache of the DB on or off.
+
+static void benchOpen(int count, bool cached)
+{
+  File* file;
+
+  CALL(db.setFileCache(cached ? DEFFILECACHE : 0));
+  double start = now();
+  for (int i = 0; i < count; i++) {
+    CALL(db.openFile(BENCHFILE, file));
+    CALL(db.closeFile(file));
+  }
+  double secs = now() - start;
+  printf("%-28s %8d opens %10.0f opens/sec\n",
+	 cached ? "DB::openFile cached" : "DB::openFile uncached",
+	 count, count / secs);
+  CALL(db.setFileCache(DEFFILECACHE));
+}
+
+// Random page reads kept depth deep with File::readPageAsync. The
+// file is opened for direct I/O where possible so that the reads
+// are not served from the OS cache.
+
+static void benchQueueDepth(int pages, const int* order, int depth)
+{
+  File* file;
+  void* buf;
+  int count = pages - 1 < 10000 ? pages - 1 : 10000;
+
+  if (posix_memalign(&buf, IOALIGN, depth * PAGESIZE) != 0) {
+    cerr << "cannot allocate " << depth << " pages" << endl;
+    exit(1);
+  }
+  IOHandle* handles = new IOHandle[depth];
+
+  db.setDirectIO(true);
+  CALL(db.openFile(BENCHFILE, file));
+  db.setDirectIO(false);
+
+  file->clearIOStats();
+  double start = now();
+  int next = 0;
+  for (int i = 0; i < depth && next < count; i++, next++)
+    CALL(file->readPageAsync(order[next], (Page*)((char*)buf + i * PAGESIZE),
+			     handles[i]));
+  for (int i = 0; i < count; i++) {
+    int slot = i % depth;
+    CALL(File::waitIO(handles[slot]));
+    if (next < count)
+      CALL(file->readPageAsync(order[next++],
+			       (Page*)((char*)buf + slot * PAGESIZE),
+			       handles[slot]));
+  }
+  char name[40];
+  sprintf(name, "async read %s depth %d",
+	  file->isDirect() ? "direct" : "cached", depth);
+  report(name, count, file->getIOStats().reads, now() - start);
+
+  CALL(db.closeFile(file));
+  delete [] handles;
+  free(buf);
+}
+
+// Several threads fetching pages through one BufMgr. Each thread
+// reads random pages of MTFILE, whose page numbers are kept in
+// mtPageNos, checks the page number stamped in the middle of the
+// page and unpins the page, marking every tenth one dirty. Pages are
+// not changed, as BufMgr does not latch page contents. With as many frames as pages every fetch is a hit and
+// the hit path is timed; with fewer frames than pages pages are
+// replaced and written back concurrently.
+
+static int* mtPageNos;
+
+struct FetchArg
+{
+  File* file;
+  int pages;
+  int fetches;
+  unsigned seed;
+  int errors;
+};
+
+static int* pageStamp(Page* page)
+{
+  return (int*)((char*)page + PAGESIZE / 2);
+}
+
+static void* fetchPages(void* p)
+{
+  FetchArg* arg = (FetchArg*)p;
+  Page* page;
+
+  for (int i = 0; i < arg->fetches; i++) {
+    int pageNo = mtPageNos[rand_r(&arg->seed) % arg->pages];
+    if (bufMgr->readPage(arg->file, pageNo, page) != OK) {
+      arg->errors++;
+      continue;
+    }
+    bool dirty = i % 10 == 0;
+    if (*pageStamp(page) != pageNo)
+      arg->errors++;
+    if (bufMgr->unPinPage(arg->file, pageNo, dirty) != OK)
+      arg->errors++;
+  }
+  return NULL;
+}
+
+static void makeStampedFile(int pages)
+{
+  File* file;
+  Page* page;
+  int pageNo;
+
+  mtPageNos = new int[pages];
+  bufMgr = new BufMgr(100);
+  (void)db.destroyFile(MTFILE);
+  CALL(db.createFile(MTFILE));
+  CALL(db.openFile(MTFILE, file));
+  for (int i = 0; i < pages; i++) {
+    CALL(bufMgr->allocPage(file, pageNo, page));
+    page->init(pageNo);
+    *pageStamp(page) = pageNo;
+    mtPageNos[i] = pageNo;
+    CALL(bufMgr->unPinPage(file, pageNo, true));
+  }
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+static void benchThreads(int pages, int frames, int threads, int fetches,
+			 ReplPolicy policy = CLOCK)
+{
+  File* file;
+  pthread_t tids[threads];
+  FetchArg args[threads];
+
+  bufMgr = new BufMgr(frames, policy);
+  CALL(db.openFile(MTFILE, file));
+
+  // warm the pool
+  for (int i = 0; i < pages && i < frames; i++) {
+    Page* page;
+    CALL(bufMgr->readPage(file, mtPageNos[i], page));
+    CALL(bufMgr->unPinPage(file, mtPageNos[i], false));
+  }
+
+  file->clearIOStats();
+  double start = now();
+  for (int t = 0; t < threads; t++) {
+    args[t].file = file;
+    args[t].pages = pages;
+    args[t].fetches = fetches / threads;
+    args[t].seed = 564 + t;
+    args[t].errors = 0;
+    if (pthread_create(&tids[t], NULL, fetchPages, &args[t]) != 0) {
+      perror("pthread_create");
+      exit(1);
+    }
+  }
+  int errors = 0;
+  for (int t = 0; t < threads; t++) {
+    pthread_join(tids[t], NULL);
+    errors += args[t].errors;
+  }
+  double secs = now() - start;
+  if (errors > 0) {
+    cerr << errors << " bad fetches with " << threads << " threads" << endl;
+    exit(1);
+  }
+
+  char name[40];
+  sprintf(name, "readPage %s %d threads",
+	  frames >= pages ? "hits" : "stress", threads);
+  if (policy != CLOCK)
+    sprintf(name, "readPage %s %s %d thr", Replacer::name(policy),
+	    frames >= pages ? "hits" : "stress", threads);
+  const IOStats & stats = file->getIOStats();
+  report(name, fetches / threads * threads, stats.reads + stats.writes,
+	 secs, "pin");
+
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+// Time lookups in a page table holding entries pages of 8 files,
+// consecutive page numbers in each file as a scan leaves them, in
+// random order, then a remove and re-insert of each entry as a
+// replacement does.
+
+static void benchLookup(int entries, int lookups)
+{
+  BufHashTbl table(entries);
+  static char files[8];
+  int perFile = entries / 8;
+  int frameNo;
+
+  for (int i = 0; i < perFile * 8; i++)
+    CALL(table.insert((File*)&files[i % 8], i / 8, i));
+
+  unsigned seed = 564;
+  int* keys = new int[lookups];
+  for (int i = 0; i < lookups; i++)
+    keys[i] = rand_r(&seed) % (perFile * 8);
+
+  double start = now();
+  for (int i = 0; i < lookups; i++) {
+    int key = keys[i];
+    if (table.lookup((File*)&files[key % 8], key / 8, frameNo) != OK
+	|| frameNo != key) {
+      cerr << "bad lookup of entry " << key << endl;
+      exit(1);
+    }
+  }
+  report("BufHashTbl::lookup", lookups, 0, now() - start, "lookup");
+
+  start = now();
+  for (int i = 0; i < lookups; i++) {
+    int key = keys[i];
+    CALL(table.remove((File*)&files[key % 8], key / 8));
+    CALL(table.insert((File*)&files[key % 8], key / 8, key));
+  }
+  report("BufHashTbl remove+insert", lookups, 0, now() - start, "op");
+  delete [] keys;
+}
+
+// Page reference strings on which the replacement policies are
+// compared, as indexes into mtPageNos; each returns its length.
+// nestedLoop rescans an inner relation of 90% of the pool once per
+// outer page, bigLoop one of 150%, catalogScans scans a large relation while looking up
+// a few catalog pages every 20 pages, and skewed sends 80% of the
+// references to 10% of span pages.
+
+#define POLICYFRAMES 100
+
+static int loop(int* refs, int inner)
+{
+  int outer = 40;
+  int n = 0;
+  for (int o = 0; o < outer; o++) {
+    refs[n++] = o;
+    for (int i = 0; i < inner; i++)
+      refs[n++] = outer + i;
+  }
+  return n;
+}
+
+static int nestedLoop(int* refs, int span)
+{
+  return loop(refs, POLICYFRAMES * 9 / 10);
+}
+
+static int bigLoop(int* refs, int span)
+{
+  return loop(refs, POLICYFRAMES * 3 / 2);
+}
+
+static int catalogScans(int* refs, int span)
+{
+  int hot = 8;
+  int n = 0;
+  for (int scan = 0; scan < 5; scan++)
+    for (int i = hot; i < span; i++) {
+      if (i % 20 == 0)
+	refs[n++] = i / 20 % hot;
+      refs[n++] = i;
+    }
+  return n;
+}
+
+static int skewed(int* refs, int span)
+{
+  unsigned seed = 564;
+  int hot = span / 10;
+  int n;
+  for (n = 0; n < 20000; n++)
+    refs[n] = rand_r(&seed) % 10 < 8 ? rand_r(&seed) % hot
+      : hot + rand_r(&seed) % (span - hot);
+  return n;
+}
+
+// Replay each reference string with each policy on a pool of
+// POLICYFRAMES frames and report the hit ratio.
+
+static void benchPolicy(int pages)
+{
+  static const char* names[] = { "nested loop", "big loop",
+				  "catalog+scans", "skewed" };
+  static int (*workloads[])(int*, int) = { nestedLoop, bigLoop,
+					   catalogScans, skewed };
+  int span = pages < 1000 ? pages : 1000;
+  int* refs = new int[10 * span + 20000];
+  File* file;
+  Page* page;
+
+  for (int w = 0; w < 4; w++) {
+    int n = workloads[w](refs, span);
+    for (int p = CLOCK; p <= ARC; p++) {
+      bufMgr = new BufMgr(POLICYFRAMES, (ReplPolicy)p);
+      CALL(db.openFile(MTFILE, file));
+      double start = now();
+      for (int i = 0; i < n; i++) {
+	CALL(bufMgr->readPage(file, mtPageNos[refs[i]], page));
+	CALL(bufMgr->unPinPage(file, mtPageNos[refs[i]], false));
+      }
+      double secs = now() - start;
+      const BufStats & stats = bufMgr->getBufStats();
+
+      char name[40];
+      sprintf(name, "%s %s", Replacer::name((ReplPolicy)p), names[w]);
+      printf("%-28s %8d pins %9.1f%% hits %10.0f pins/sec\n", name, n,
+	     100.0 * (stats.accesses - stats.misses) / stats.accesses,
+	     n / secs);
+      CALL(db.closeFile(file));
+      delete bufMgr;
+      bufMgr = NULL;
+    }
+  }
+  delete [] refs;
+}
+
+// Resize a pool of POLICYFRAMES frames online: grow it to hold all
+// pages of the stamped file, then shrink it back, with one page
+// pinned throughout and every tenth page dirtied. After each resize
+// all pages are read twice and the second pass is reported.
+
+static void benchResize(int pages)
+{
+  File* file;
+  Page* page;
+  Page* pinned;
+  int sizes[] = { pages + 1, POLICYFRAMES };
+
+  bufMgr = new BufMgr(POLICYFRAMES);
+  CALL(db.openFile(MTFILE, file));
+  CALL(bufMgr->readPage(file, mtPageNos[0], pinned));
+
+  for (int r = 0; r < 2; r++) {
+    double start = now();
+    CALL(bufMgr->resize(sizes[r]));
+    double resizeSecs = now() - start;
+
+    double passSecs = 0;
+    for (int pass = 0; pass < 2; pass++) {
+      bufMgr->clearBufStats();
+      start = now();
+      for (int i = 0; i < pages; i++) {
+	CALL(bufMgr->readPage(file, mtPageNos[i], page));
+	if (*pageStamp(page) != mtPageNos[i]) {
+	  cerr << "page " << mtPageNos[i] << " lost by resize" << endl;
+	  exit(1);
+	}
+	CALL(bufMgr->unPinPage(file, mtPageNos[i], i % 10 == 0));
+      }
+      passSecs = now() - start;
+    }
+
+    const BufStats & stats = bufMgr->getBufStats();
+    printf("%-28s %8d frames %8.3f ms resize %10.0f pages/sec %5.1f%% hits\n",
+	   r == 0 ? "grow pool online" : "shrink pool online", sizes[r],
+	   resizeSecs * 1e3, pages / passSecs,
+	   100.0 * (stats.accesses - stats.misses) / stats.accesses);
+  }
+
+  if (*pageStamp(pinned) != mtPageNos[0]) {
+    cerr << "pinned page moved by resize" << endl;
+    exit(1);
+  }
+  CALL(bufMgr->unPinPage(file, mtPageNos[0], false));
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+// Save the list of a hot set of half the pages of the stamped file,
+// read in random order into a pool, then time fetching the hot set
+// into a new pool through random misses against restoring it with
+// loadPool first. Direct I/O keeps the OS cache out of both.
+
+#define BENCHLIST  "iobench.pages"
+
+static void benchWarmStart(int pages)
+{
+  File* file;
+  Page* page;
+  int hot = pages / 2;
+  int* hotPages = new int[hot];
+  unsigned seed = 564;
+
+  for (int i = 0; i < hot; i++)
+    hotPages[i] = mtPageNos[rand_r(&seed) % pages];
+
+  db.setDirectIO(true);
+  for (int run = 0; run < 3; run++) {
+    bufMgr = new BufMgr(pages + 1);
+    CALL(db.openFile(MTFILE, file));
+    file->clearIOStats();
+    double start = now();
+    if (run == 2) {
+      CALL(bufMgr->loadPool(db, BENCHLIST));
+    }
+    for (int i = 0; i < hot; i++) {
+      CALL(bufMgr->readPage(file, hotPages[i], page));
+      if (*pageStamp(page) != hotPages[i]) {
+	cerr << "page " << hotPages[i] << " restored wrongly" << endl;
+	exit(1);
+      }
+      CALL(bufMgr->unPinPage(file, hotPages[i], false));
+    }
+    double secs = now() - start;
+    if (run == 0) {
+      CALL(bufMgr->dumpPool(BENCHLIST));
+    }
+    else
+      report(run == 1 ? "hot set after cold start" : "hot set after warm start",
+	     hot, file->getIOStats().reads, secs);
+    CALL(db.closeFile(file));
+    delete bufMgr;
+    bufMgr = NULL;
+  }
+  db.setDirectIO(false);
+  (void)unlink(BENCHLIST);
+  delete [] hotPages;
+}
+
+// Read a hot set of 40 pages into a pool of POLICYFRAMES frames,
+// scan span other pages with or without a BULKREAD ring, and report
+// the scan rate and how much of the hot set is still in the pool.
+
+static void benchRing(int span, bool ring)
+{
+  File* file;
+  Page* page;
+  int hot = 40;
+
+  bufMgr = new BufMgr(POLICYFRAMES);
+  CALL(db.openFile(MTFILE, file));
+  for (int pass = 0; pass < 2; pass++)
+    for (int i = 0; i < hot; i++) {
+      CALL(bufMgr->readPage(file, mtPageNos[i], page));
+      CALL(bufMgr->unPinPage(file, mtPageNos[i], false));
+    }
+
+  BufStrategy* strategy = ring ? new BufStrategy(BULKREAD) : NULL;
+  double start = now();
+  for (int i = hot; i < span; i++) {
+    CALL(bufMgr->readPage(file, mtPageNos[i], page, strategy));
+    CALL(bufMgr->unPinPage(file, mtPageNos[i], false));
+  }
+  double secs = now() - start;
+  delete strategy;
+
+  bufMgr->clearBufStats();
+  for (int i = 0; i < hot; i++) {
+    CALL(bufMgr->readPage(file, mtPageNos[i], page));
+    CALL(bufMgr->unPinPage(file, mtPageNos[i], false));
+  }
+  const BufStats & stats = bufMgr->getBufStats();
+  printf("%-28s %8d pages %10.0f pages/sec %5.1f%% of hot set kept\n",
+	 ring ? "scan with BULKREAD ring" : "scan through pool",
+	 span - hot, (span - hot) / secs,
+	 100.0 * (stats.accesses - stats.misses) / stats.accesses);
+
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+}
+
+static int dblCmp(const void* p1, const void* p2)
+{
+  double d1 = *(const double*)p1, d2 = *(const double*)p2;
+  return d1 < d2 ? -1 : d1 > d2;
+}
+
+// Update random pages of the stamped file through a pool of
+// POLICYFRAMES frames, with or without the background writer, and
+// report the rate, the 99th percentile time of a fetch and the share
+// of the writes the writer did. The file is opened direct, so that
+// a fetch that has to wait for a write waits for the disk.
+
+static void benchWriter(int pages, int fetches, bool bg)
+{
+  File* file;
+  Page* page;
+  double* times = new double[fetches];
+  unsigned seed = 564;
+
+  db.setDirectIO(true);
+  bufMgr = new BufMgr(POLICYFRAMES);
+  if (bg)
+    CALL(bufMgr->startWriter(WriterConfig()));
+  CALL(db.openFile(MTFILE, file));
+
+  double start = now();
+  for (int i = 0; i < fetches; i++) {
+    int pageNo = mtPageNos[rand_r(&seed) % pages];
+    double t = now();
+    CALL(bufMgr->readPage(file, pageNo, page));
+    times[i] = now() - t;
+    (*pageStamp(page))++;
+    CALL(bufMgr->unPinPage(file, pageNo, true));
+  }
+  double secs = now() - start;
+  bufMgr->stopWriter();
+
+  qsort(times, fetches, sizeof(double), dblCmp);
+  const BufStats & stats = bufMgr->getBufStats();
+  printf("%-28s %8d pins %10.0f pins/sec %7.0f us p99 %5.1f%% bg writes "
+	 "%5.1f%% dirty evictions\n",
+	 bg ? "updates with bg writer" : "updates without bg writer",
+	 fetches, fetches / secs, times[fetches * 99 / 100] * 1e6,
+	 100.0 * stats.bgwrites / (stats.diskwrites ? stats.diskwrites : 1),
+	 100.0 * stats.dirtyEvictions / (stats.evictions ? stats.evictions : 1));
+  delete [] times;
+
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+  db.setDirectIO(false);
+}
+
+// Load a heap file of records through InsertFileScan, opened direct,
+// with or without the background writer.
+
+static void benchInsert(int records, bool bg)
+{
+  Status status;
+  char data[RECLEN];
+  Record rec;
+  RID rid;
+  rec.data = data;
+  rec.length = RECLEN;
+  memset(data, 'a', RECLEN);
+
+  db.setDirectIO(true);
+  bufMgr = new BufMgr(POLICYFRAMES);
+  if (bg)
+    CALL(bufMgr->startWriter(WriterConfig()));
+  (void)destroyHeapFile(BENCHREL);
+  CALL(createHeapFile(BENCHREL));
+
+  InsertFileScan* ifs = new InsertFileScan(BENCHREL, status);
+  CALL(status);
+  double start = now();
+  for (int i = 0; i < records; i++)
+    CALL(ifs->insertRecord(rec, rid));
+  delete ifs;
+  CALL(bufMgr->flushAll());
+  double secs = now() - start;
+
+  const BufStats & stats = bufMgr->getBufStats();
+  printf("%-28s %8d recs %10.0f recs/sec %5.1f%% bg writes\n",
+	 bg ? "inserts with bg writer" : "inserts without bg writer",
+	 records, records / secs,
+	 100.0 * stats.bgwrites / (stats.diskwrites ? stats.diskwrites : 1));
+
+  delete bufMgr;
+  bufMgr = NULL;
+  db.setDirectIO(false);
+}
+
+// Load a heap file with records of RECLEN bytes and return their
+// RIDs in random order.
+
+static RID* loadHeap(int records)
+{
+  Status status;
+  char data[RECLEN];
+  Record rec;
+  rec.data = data;
+  rec.length = RECLEN;
+
+  bufMgr = new BufMgr(100);
+  (void)destroyHeapFile(BENCHREL);
+  CALL(createHeapFile(BENCHREL));
+
+  RID* rids = new RID[records];
+  InsertFileScan* ifs = new InsertFileScan(BENCHREL, status);
+  CALL(status);
+  for (int i = 0; i < records; i++) {
+    memset(data, 'a' + i % 26, RECLEN);
+    CALL(ifs->insertRecord(rec, rids[i]));
+  }
+  delete ifs;
+  delete bufMgr;
+  bufMgr = NULL;
+
+  srand(564);
+  for (int i = records - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    RID tmp = rids[i]; rids[i] = rids[j]; rids[j] = tmp;
+  }
+  return rids;
+}
+
+// Scan the heap file and fetch its records in random order through
+// a 100 frame buffer pool, with the file opened buffered or direct.
+
+static void benchHeap(int records, const RID* rids, bool direct)
+{
+  Status status;
+  File* file;
+  RID rid;
+  Record rec;
+
+  db.setDirectIO(direct);
+  bufMgr = new BufMgr(100);
+  CALL(db.openFile(BENCHREL, file));
+  const char* mode = file->isDirect() ? "direct" : "buffered";
+  char name[40];
+
+  HeapFileScan* hfs = new HeapFileScan(BENCHREL, status);
+  CALL(status);
+  CALL(hfs->startScan(0, 0, STRING, NULL, EQ));
+  file->clearIOStats();
+  double start = now();
+  int count = 0;
+  while (hfs->scanNext(rid) == OK) {
+    CALL(hfs->getRecord(rec));
+    count++;
+  }
+  sprintf(name, "heap scan %s", mode);
+  report(name, count, file->getIOStats().reads, now() - start, "rec");
+  delete hfs;
+
+  HeapFile* hf = new HeapFile(BENCHREL, status);
+  CALL(status);
+  file->clearIOStats();
+  start = now();
+  for (int i = 0; i < records; i++)
+    CALL(hf->getRecord(rids[i], rec));
+  sprintf(name, "getRecord random %s", mode);
+  report(name, records, file->getIOStats().reads, now() - start, "rec");
+  delete hf;
+
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+  db.setDirectIO(false);
+}
+
+// Scan the heap file through a 100 frame buffer pool with at most
+// window pages read ahead. The file is opened direct, so that no
+// page is found in the OS cache and every page the scan has not
+// read ahead is waited for.
+
+static void benchReadAhead(int window)
+{
+  Status status;
+  File* file;
+  RID rid;
+  Record rec;
+
+  db.setDirectIO(true);
+  bufMgr = new BufMgr(100);
+  CALL(db.openFile(BENCHREL, file));
+  int saved = HeapFileScan::readAheadMax;
+  HeapFileScan::readAheadMax = window;
+  char name[40];
+
+  HeapFileScan* hfs = new HeapFileScan(BENCHREL, status);
+  CALL(status);
+  CALL(hfs->startScan(0, 0, STRING, NULL, EQ));
+  file->clearIOStats();
+  double start = now();
+  int count = 0;
+  while (hfs->scanNext(rid) == OK) {
+    CALL(hfs->getRecord(rec));
+    count++;
+  }
+  sprintf(name, "cold scan read-ahead %d", window);
+  report(name, count, file->getIOStats().reads, now() - start, "rec");
+  delete hfs;
+
+  HeapFileScan::readAheadMax = saved;
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+  db.setDirectIO(false);
+}
+
+// Fill a page with 4-byte records, delete nine in ten of them and
+// scan the rest, then fill the holes again, rounds times over, with
+// or without a slot bitmap on the page.
+
+static void benchPage(int flags, int rounds)
+{
+  Page* page = (Page*)new char[PAGESIZE];
+  int value = 0;
+  Record rec;
+  RID rid;
+  rec.data = &value;
+  rec.length = sizeof(value);
+  const char* map = flags & SLOTMAP ? " slotmap" : "";
+  char name[40];
+
+  int inserts = 0;
+  double insertSecs = 0, scanSecs = 0, refillSecs = 0;
+  long scanned = 0, refills = 0;
+  for (int r = 0; r < rounds; r++) {
+    page->init(1, flags);
+    double start = now();
+    while (page->insertRecord(rec, rid) == OK)
+      inserts++;
+    insertSecs += now() - start;
+
+    int slots = rid.slotNo + 1;
+    for (int i = 0; i < slots; i++)
+      if (i % 10 != 0) {
+	rid.slotNo = i;
+	CALL(page->deleteRecord(rid));
+      }
+
+    start = now();
+    for (int pass = 0; pass < 10; pass++) {
+      Status status = page->firstRecord(rid);
+      while (status == OK) {
+	scanned++;
+	status = page->nextRecord(rid, rid);
+      }
+    }
+    scanSecs += now() - start;
+
+    start = now();
+    while (page->insertRecord(rec, rid) == OK)
+      refills++;
+    refillSecs += now() - start;
+  }
+
+  sprintf(name, "Page::insertRecord%s", map);
+  report(name, inserts, 0, insertSecs, "rec");
+  sprintf(name, "Page scan 10%% live%s", map);
+  report(name, scanned, 0, scanSecs, "rec");
+  sprintf(name, "Page refill holes%s", map);
+  report(name, refills, 0, refillSecs, "rec");
+  delete [] (char*)page;
+}
+
+// Compares the slotted and the fixed-length record page formats on
+// records of recLen bytes: records a page holds, fetching them by
+// RID, and deleting every other one.
+
+static void benchFormat(int flags, int recLen, int rounds)
+{
+  Page* page = (Page*)new char[PAGESIZE];
+  char data[256];
+  Record rec;
+  RID rid;
+  memset(data, 1, sizeof(data));
+  rec.data = data;
+  rec.length = recLen;
+  const char* format = flags & FIXEDREC ? "fixed" : "slotted";
+  char name[40];
+
+  int slots = 0;
+  long gets = 0, deletes = 0;
+  double getSecs = 0, deleteSecs = 0;
+  for (int r = 0; r < rounds; r++) {
+    page->init(1, flags, recLen);
+    slots = 0;
+    while (page->insertRecord(rec, rid) == OK)
+      slots++;
+
+    double start = now();
+    for (int pass = 0; pass < 10; pass++)
+      for (rid.slotNo = 0; rid.slotNo < slots; rid.slotNo++)
+	CALL(page->getRecord(rid, rec));
+    gets += 10 * slots;
+    getSecs += now() - start;
+
+    start = now();
+    for (rid.slotNo = 0; rid.slotNo < slots; rid.slotNo += 2)
+      CALL(page->deleteRecord(rid));
+    deletes += (slots + 1) / 2;
+    deleteSecs += now() - start;
+  }
+
+  cout << format << " page, " << recLen << " byte records: " << slots
+       << " per page" << endl;
+  sprintf(name, "Page::getRecord %s %d", format, recLen);
+  report(name, gets, 0, getSecs, "rec");
+  sprintf(name, "Page::deleteRecord %s %d", format, recLen);
+  report(name, deletes, 0, deleteSecs, "rec");
+  delete [] (char*)page;
+}
+
+// Load records Wisconsin-style tuples, 13 integers and 3 strings of
+// 52 bytes, into a relation laid out as flags says, then scan it in a
+// buffer pool that holds all of it for the 1% of tuples whose first
+// integer is below records / 100, projecting two integers. Tuple i
+// holds i in all integers but the first; the fields read are checked
+// against the tuples loaded and, in the first scan, against the
+// tuples read whole.
+
+static void benchPax(int records, int flags)
+{
+  Status status;
+  short colLen[16];
+  int tuple[52];
+  Record rec;
+  RID rid;
+  for (int c = 0; c < 16; c++)
+    colLen[c] = c < 13 ? sizeof(int) : 52;
+  memset(tuple, 'x', sizeof(tuple));
+  rec.data = tuple;
+  rec.length = sizeof(tuple);
+
+  int bound = records / 100;
+  int expected = 0;
+  long long expectedSum = 0;
+
+  bufMgr = new BufMgr(100);
+  (void)destroyHeapFile(PAXREL);
+  CALL(createHeapFile(PAXREL, DEFEXTENT, flags, rec.length, 16, colLen));
+  InsertFileScan* ifs = new InsertFileScan(PAXREL, status);
+  CALL(status);
+  srand(17);
+  for (int i = 0; i < records; i++) {
+    for (int c = 0; c < 13; c++)
+      tuple[c] = c == 0 ? rand() % records : i;
+    if (tuple[0] < bound) {
+      expected++;
+      expectedSum += i;
+    }
+    CALL(ifs->insertRecord(rec, rid));
+  }
+  delete ifs;
+  delete bufMgr;
+
+  File* file;
+  int pages = 0;
+  CALL(db.openFile(PAXREL, file));
+  for (int pageNo = 0; pageNo <= records; pageNo++)
+    if (file->isAllocated(pageNo))
+      pages++;
+  bufMgr = new BufMgr(pages + 10);
+  const char* layout = flags & PAX ? "pax" : "rows";
+  char name[40];
+
+  int matched = 0;
+  double secs = 0;
+  for (int pass = 0; pass < 11; pass++) {
+    HeapFileScan* hfs = new HeapFileScan(PAXREL, status);
+    CALL(status);
+    CALL(hfs->startScan(0, sizeof(int), INTEGER, (char*)&bound, LT));
+    int count = 0;
+    long long sum = 0;
+    bool wrong = false;
+    double start = now();
+    while (hfs->scanNext(rid) == OK) {
+      int proj[2];
+      CALL(hfs->getField(4, sizeof(int), (char*)&proj[0]));
+      CALL(hfs->getField(8, sizeof(int), (char*)&proj[1]));
+      count++;
+      sum += proj[0];
+      wrong |= proj[1] != proj[0];
+      if (pass == 0) {                  // against the whole tuple
+	int key;
+	Record tup;
+	CALL(hfs->getField(0, sizeof(int), (char*)&key));
+	CALL(hfs->getRecord(tup));
+	wrong |= key >= bound || key != ((int*)tup.data)[0]
+	  || proj[0] != ((int*)tup.data)[1];
+      }
+    }
+    if (pass > 0)                       // the first pass reads the file
+      secs += now() - start;
+    delete hfs;
+    if (wrong || count != expected || sum != expectedSum) {
+      cerr << "select on " << (flags & PAX ? "pax" : "rows")
+	   << " returned wrong fields" << endl;
+      exit(1);
+    }
+    if (pass > 0)
+      matched += count;
+  }
+  sprintf(name, "select 1%% scan %s", layout);
+  report(name, 10 * records, 0, secs, "rec");
+  cout << layout << ": " << pages << " pages, " << matched / 10
+       << " tuples selected" << endl;
+
+  CALL(db.closeFile(file));
+  delete bufMgr;
+  bufMgr = NULL;
+  CALL(destroyHeapFile(PAXREL));
+}
+
+// # of pages of the file of a relation of records records
+
+static int relPages(const char* name, int records)
+{
+  File* file;
+  int pages = 0;
+  CALL(db.openFile(name, file));
+  for (int pageNo = 0; pageNo <= records; pageNo++)
+    if (file->isAllocated(pageNo))
+      pages++;
+  CALL(db.closeFile(file));
+  return pages;
+}
+
+// Load a relation with records records, then rounds times delete a
+// random half of them and insert as many again. Inserts go to the
+// pages the deletes made room on, so the file should keep its size.
+
+static void benchChurn(int records, int rounds)
+{
+  Status status;
+  char data[RECLEN];
+  Record rec;
+  RID rid;
+  rec.data = data;
+  rec.length = RECLEN;
+  memset(data, 'c', RECLEN);
+
+  bufMgr = new BufMgr(100);
+  (void)destroyHeapFile(BENCHREL);
+  CALL(createHeapFile(BENCHREL, DEFEXTENT, FIXEDREC, RECLEN));
+  InsertFileScan* ifs = new InsertFileScan(BENCHREL, status);
+  CALL(status);
+  for (int i = 0; i < records; i++)
+    CALL(ifs->insertRecord(rec, rid));
+  delete ifs;
+  CALL(bufMgr->flushAll());
+  int pagesBefore = relPages(BENCHREL, 2 * records);
+
+  srand(3);
+  double start = now();
+  for (int r = 0; r < rounds; r++) {
+    HeapFileScan* hfs = new HeapFileScan(BENCHREL, status);
+    CALL(status);
+    CALL(hfs->startScan(0, 0, STRING, NULL, EQ));
+    int deleted = 0;
+    while (hfs->scanNext(rid) == OK)
+      if (rand() % 2) {
+	CALL(hfs->deleteRecord());
+	deleted++;
+      }
+    delete hfs;
+
+    ifs = new InsertFileScan(BENCHREL, status);
+    CALL(status);
+    for (int i = 0; i < deleted; i++)
+      CALL(ifs->insertRecord(rec, rid));
+    delete ifs;
+  }
+  CALL(bufMgr->flushAll());
+  double secs = now() - start;
+  int pagesAfter = relPages(BENCHREL, 2 * records);
+
+  printf("%-28s %8d recs %10.0f recs/sec %6d pages before %6d after\n",
+	 "delete and insert churn", rounds * records, rounds * records / secs,
+	 pagesBefore, pagesAfter);
+  delete bufMgr;
+  bufMgr = NULL;
+  CALL(destroyHeapFile(BENCHREL));
+}
+
+// Load a relation with records records, delete nine in ten of them
+// at random and vacuum it, all at once or step pages at a time, then
+// check that the records left are all there.
+
+static void benchVacuum(int records, int step)
+{
+  Status status;
+  int data[RECLEN / sizeof(int)];
+  Record rec;
+  RID rid;
+  rec.data = data;
+  rec.length = sizeof(data);
+  memset(data, 0, sizeof(data));
+
+  bufMgr = new BufMgr(100);
+  (void)destroyHeapFile(BENCHREL);
+  CALL(createHeapFile(BENCHREL, DEFEXTENT, FIXEDREC, rec.length));
+  InsertFileScan* ifs = new InsertFileScan(BENCHREL, status);
+  CALL(status);
+  for (int i = 0; i < records; i++) {
+    data[0] = i;
+    CALL(ifs->insertRecord(rec, rid));
+  }
+  delete ifs;
+
+  srand(5);
+  long long sum = 0;
+  int left = 0;
+  HeapFileScan* hfs = new HeapFileScan(BENCHREL, status);
+  CALL(status);
+  CALL(hfs->startScan(0, 0, STRING, NULL, EQ));
+  while (hfs->scanNext(rid) == OK)
+    if (rand() % 10) {
+      CALL(hfs->deleteRecord());
+    } else {
+      CALL(hfs->getRecord(rec));
+      sum += *(int*)rec.data;
+      left++;
+    }
+  delete hfs;
+  CALL(bufMgr->flushAll());
+  int pagesBefore = relPages(BENCHREL, records);
+
+  double start = now();
+  int steps = 0, examined, moved, freed, allMoved = 0;
+  HeapFile* hf = new HeapFile(BENCHREL, status);
+  CALL(status);
+  do {
+    CALL(hf->vacuum(step, examined, moved, freed));
+    allMoved += moved;
+    steps++;
+  } while (step > 0 && examined == step);
+  delete hf;
+  CALL(bufMgr->flushAll());
+  double secs = now() - start;
+  int pagesAfter = relPages(BENCHREL, records);
+
+  // the records left must all still be there
+  hfs = new HeapFileScan(BENCHREL, status);
+  CALL(status);
+  CALL(hfs->startScan(0, 0, STRING, NULL, EQ));
+  while (hfs->scanNext(rid) == OK) {
+    CALL(hfs->getRecord(rec));
+    sum -= *(int*)rec.data;
+    left--;
+  }
+  delete hfs;
+  if (sum != 0 || left != 0) {
+    cerr << "vacuum lost or duplicated records" << endl;
+    exit(1);
+  }
+
+  char name[40];
+  sprintf(name, "vacuum %s", step ? "in steps" : "all at once");
+  printf("%-28s %8d recs %10.0f recs/sec %6d pages before %6d after, "
+	 "%d steps\n", name, allMoved, allMoved / secs, pagesBefore,
+	 pagesAfter, steps);
+  delete bufMgr;
+  bufMgr = NULL;
+  CALL(destroyHeapFile(BENCHREL));
+}
+
+int main(int argc, char** argv)
+{
+  int pages = argc > 1 ? atoi(argv[1]) : 100000;
+  File* file;
+
+  if (pages < 2) {
+    cerr << "Usage: " << argv[0] << " [pages [pagesize]]" << endl;
+    return 1;
+  }
+  if (argc > 2)
+    CALL(setPageSize(atoi(argv[2])));
+
+  (void)db.destroyFile(BENCHFILE);
+  CALL(db.createFile(BENCHFILE));
+  CALL(db.openFile(BENCHFILE, file));
+
+  double start = now();
+  file->clearIOStats();
+  for (int i = 1; i < pages; i++) {
+    int pageNo;
+    CALL(file->allocatePage(pageNo));
+  }
+  const IOStats & stats = file->getIOStats();
+  report("File::allocatePage", pages - 1, stats.reads + stats.writes, now() - start);
+
+  int* order = randomPages(pages);
+
+  benchSeek(pages, NULL, false);
+  benchFile(file, pages, NULL, false);
+  benchSeek(pages, order, false);
+  benchFile(file, pages, order, false);
+  benchSeek(pages, NULL, true);
+  benchFile(file, pages, NULL, true);
+  benchReadPages(file, pages, 64);
+  benchFlush(pages < 10000 ? pages : 10000);
+  benchSync(pages < 10000 ? pages : 10000, 8);
+  benchSmallFlush(1000, 1000);
+  benchSmallFlush(1 << 20, 1000);
+  benchGrow(1 << 20, 10);
+
+  CALL(db.closeFile(file));
+
+  benchScan(pages, READWRITE);
+  benchScan(pages, MAPPED);
+  benchOpen(10000, false);
+  benchOpen(10000, true);
+  for (int depth = 1; depth <= AIODEPTH; depth *= 4)
+    benchQueueDepth(pages, order, depth);
+  delete [] order;
+
+  benchLookup(10000, 1000000);
+  benchLookup(100000, 1000000);
+  benchPage(0, 20000);
+  benchPage(SLOTMAP, 20000);
+  for (int recLen = 8; recLen <= 200; recLen *= 5) {
+    benchFormat(SLOTMAP, recLen, 2000);
+    benchFormat(FIXEDREC, recLen, 2000);
+  }
+
+  int mtPages = pages - 1 < 10000 ? pages - 1 : 10000;
+  makeStampedFile(mtPages);
+  for (int threads = 1; threads <= 16; threads *= 2)
+    benchThreads(mtPages, mtPages, threads, 1000000);
+  for (int threads = 1; threads <= 16; threads *= 2)
+    benchThreads(mtPages, mtPages / 10 + 1, threads, 200000);
+  for (int p = LRU2; p <= ARC; p++)
+    for (int threads = 1; threads <= 16; threads *= 16) {
+      benchThreads(mtPages, mtPages, threads, 1000000, (ReplPolicy)p);
+      benchThreads(mtPages, mtPages / 10 + 1, threads, 200000, (ReplPolicy)p);
+    }
+  if (mtPages >= 1000) {
+    benchPolicy(mtPages);
+    benchRing(1000, false);
+    benchRing(1000, true);
+    benchResize(mtPages);
+    benchWarmStart(mtPages);
+    benchWriter(mtPages, 20000, false);
+    benchWriter(mtPages, 20000, true);
+  }
+  CALL(db.destroyFile(MTFILE));
+  delete [] mtPageNos;
+
+  CALL(db.destroyFile(BENCHFILE));
+
+  benchInsert(pages, false);
+  benchInsert(pages, true);
+
+  RID* rids = loadHeap(pages);
+  benchHeap(pages, rids, false);
+  benchHeap(pages, rids, true);
+  delete [] rids;
+
+  // cold scans of a relation ten times as large
+  delete [] loadHeap(10 * pages);
+  benchReadAhead(0);
+  for (int window = READAHEADMIN; window <= READAHEADMAX; window *= 2)
+    benchReadAhead(window);
+  CALL(destroyHeapFile(BENCHREL));
+
+  benchPax(10 * pages, FIXEDREC);
+  benchPax(10 * pages, FIXEDREC | PAX);
+  benchChurn(pages, 10);
+  benchVacuum(pages, 0);
+  benchVacuum(pages, 50);
+  return 0;
+}
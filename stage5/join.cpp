@@ -88,7 +88,7 @@ const Status QU_NL_Join(const string & result,
     outputRec.length = reclen;
 
     // start scan on outer table
-    HeapFileScan outerScan(string(attrDesc1.relName), status);
+    HeapFileScan outerScan(string(attrDesc1.relName), status, ScanMode);
     if (status != OK) { return status; }
     status = outerScan.startScan(0,
                                  0,
@@ -99,7 +99,7 @@ const Status QU_NL_Join(const string & result,
     
     // scan outer table
     RID outerRID;
-    Record outerRec;
+    char joinValue[attrDesc1.attrLen];
     
     Operator myop;
     switch(op) {
@@ -113,26 +113,23 @@ const Status QU_NL_Join(const string & result,
 
     while (outerScan.scanNext(outerRID) == OK)
     {
-        status = outerScan.getRecord(outerRec);
+        status = outerScan.getField(attrDesc1.attrOffset, attrDesc1.attrLen,
+                                    joinValue);
         ASSERT(status == OK);
 
         // scan inner table
-        HeapFileScan innerScan(string(attrDesc2.relName), status);
+        HeapFileScan innerScan(string(attrDesc2.relName), status, ScanMode);
         if (status != OK) { return status; }
         status = innerScan.startScan(attrDesc2.attrOffset,
                                      attrDesc2.attrLen,
                                      (Datatype) attrDesc2.attrType,
-                                     ((char *)outerRec.data) + attrDesc1.attrOffset,
+                                     joinValue,
                                      myop);
         if (status != OK) { return status; }
 
         RID innerRID;
         while (innerScan.scanNext(innerRID) == OK)
         {
-            Record innerRec;
-            status = innerScan.getRecord(innerRec);
-            ASSERT(status == OK);
-            
             // we have a match, copy data into the output record
             int outputOffset = 0;
             for (int i = 0; i < projCnt; i++)
@@ -140,16 +137,17 @@ const Status QU_NL_Join(const string & result,
                 // copy the data out of the proper input file (inner vs. outer)
                 if (0 == strcmp(attrDescArray[i].relName, attrDesc1.relName))
                 {
-                    memcpy(outputData + outputOffset,
-                           (char *)outerRec.data + attrDescArray[i].attrOffset,
-                           attrDescArray[i].attrLen);
+                    status = outerScan.getField(attrDescArray[i].attrOffset,
+                                                attrDescArray[i].attrLen,
+                                                outputData + outputOffset);
                 }
                 else // get data from the inner record
                 {
-                    memcpy(outputData + outputOffset,
-                           (char *)innerRec.data + attrDescArray[i].attrOffset,
-                           attrDescArray[i].attrLen);                    
+                    status = innerScan.getField(attrDescArray[i].attrOffset,
+                                                attrDescArray[i].attrLen,
+                                                outputData + outputOffset);
                 }
+                ASSERT(status == OK);
                 outputOffset += attrDescArray[i].attrLen;
             } // end copy attrs
 
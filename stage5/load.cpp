@@ -80,5 +80,6 @@ const Status UT_Load(const string & relation, const string & fileName)
   delete [] record;
   free(attrs);
 
-  return OK;
+  // checkpoint: make the loaded relation durable
+  return bufMgr->flushAll(true);
 }
@@ -14,11 +14,15 @@ RelCatalog *relCat;
 AttrCatalog *attrCat;
 
 JoinType JoinMethod;
+AccessMode ScanMode;
 
 int main(int argc, char **argv)
 {
   if (argc < 2) {
-    cerr << "Usage: " << argv[0] << " dbname" << endl;
+    cerr << "Usage: " << argv[0]
+         << " dbname [SM|HJ] [-m] [-d] [-r clock|lru2|2q|arc]"
+         << " [-w msec] [-c sec [-l pages/sec]] [-b frames|size{K|M|G}]"
+         << endl;
     return 1;
   }
 
@@ -27,20 +31,68 @@ int main(int argc, char **argv)
     exit(1);
   }
 
+  // use the page size the database was created with
+
+  Status status;
+  unsigned pageSize;
+  if ((status = db.getPageSize(RELCATNAME, pageSize)) != OK
+      || (status = setPageSize(pageSize)) != OK) {
+    error.print(status);
+    exit(1);
+  }
+
   JoinMethod = NLJoin;  // default join method
-  if (argc == 3) // alternative join method specified
+  ScanMode = READWRITE; // read relations through the buffer pool
+  bool directIO = false; // go through the OS cache
+  ReplPolicy policy = CLOCK; // buffer replacement policy
+  WriterConfig writer;  // background writer settings
+  bool useWriter = false;
+  const char* poolSize = getenv("MINIREL_BUFFERPOOL"); // buffer pool size
+  for (int i = 2; i < argc; i++) // alternative join method specified
   {
-       if (strcmp (argv[2],"SM") == 0) JoinMethod = SMJoin;
-       else if (strcmp (argv[2],"HJ") == 0) JoinMethod = HashJoin;
+       if (strcmp (argv[i],"SM") == 0) JoinMethod = SMJoin;
+       else if (strcmp (argv[i],"HJ") == 0) JoinMethod = HashJoin;
+       else if (strcmp (argv[i],"-m") == 0) ScanMode = MAPPED; // mmap scans
+       else if (strcmp (argv[i],"-d") == 0) directIO = true;
+       else if (strcmp (argv[i],"-r") == 0 && i + 1 < argc)
+       {
+         if (!Replacer::lookup(argv[++i], policy)) {
+           cerr << "unknown replacement policy " << argv[i] << endl;
+           exit(1);
+         }
+       }
+       else if (strcmp (argv[i],"-w") == 0 && i + 1 < argc)
+       {
+         writer.delay = atoi(argv[++i]); // clean pool every msec
+         useWriter = true;
+       }
+       else if (strcmp (argv[i],"-c") == 0 && i + 1 < argc)
+       {
+         writer.checkpointSecs = atoi(argv[++i]); // checkpoint every sec
+         useWriter = true;
+       }
+       else if (strcmp (argv[i],"-l") == 0 && i + 1 < argc)
+         writer.checkpointRate = atoi(argv[++i]); // checkpoint rate limit
+       else if (strcmp (argv[i],"-b") == 0 && i + 1 < argc)
+         poolSize = argv[++i];
   }
+  db.setDirectIO(directIO);
 
   // create buffer manager
   
-  bufMgr = new BufMgr(100);
+  int frames = 100;
+  if (poolSize && (status = BufMgr::poolFrames(poolSize, frames)) != OK) {
+    error.print(status);
+    exit(1);
+  }
+  bufMgr = new BufMgr(frames, policy);
+  if (useWriter && (status = bufMgr->startWriter(writer)) != OK) {
+    error.print(status);
+    exit(1);
+  }
   
   // open relation and attribute catalogs
 
-  Status status;
   relCat = new RelCatalog(status);
   if (status == OK)
     attrCat = new AttrCatalog(status);
@@ -49,12 +101,33 @@ int main(int argc, char **argv)
     exit(1);
   }
 
+  // bring back the pages that were in the pool when minirel last quit
+
+  if ((status = bufMgr->loadPool(db, POOLLISTNAME)) != OK)
+    error.print(status);
+
   cout << "Welcome to Minirel" << endl;
   cout << "    Using ";
   if (JoinMethod == NLJoin) {cout << "Nested Loops Join Method" << endl;}
   else 
   if (JoinMethod == HashJoin) {cout << "Hash Join Method" << endl;}
   else {cout << "Sort Merge Join Method" << endl;}
+  if (ScanMode == MAPPED)
+    cout << "    Scanning relations through memory mappings" << endl;
+  if (directIO)
+    cout << "    Bypassing the OS cache with direct I/O" << endl;
+  if (frames != 100)
+    cout << "    Using a buffer pool of " << frames << " frames" << endl;
+  if (policy != CLOCK)
+    cout << "    Replacing buffer pages with " << Replacer::name(policy)
+         << endl;
+
+  if (useWriter) {
+    cout << "    Cleaning the buffer pool every " << writer.delay << " ms";
+    if (writer.checkpointSecs > 0)
+      cout << ", checkpointing every " << writer.checkpointSecs << " s";
+    cout << endl;
+  }
 
   extern void parse();
   parse();
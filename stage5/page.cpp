@@ -6,25 +6,155 @@ using namespace std;
 #include "page.h"
 #include "string.h"
 
+// page size of the database in use
+
+unsigned PAGESIZE = DEFPAGESIZE;
+
+// Set the page size. It must be a power of two between MINPAGESIZE
+// and MAXPAGESIZE.
+
+const Status setPageSize(const unsigned pageSize)
+{
+    if (pageSize < MINPAGESIZE || pageSize > MAXPAGESIZE
+        || (pageSize & (pageSize - 1)) != 0)
+        return BADPAGESIZE;
+
+    PAGESIZE = pageSize;
+    return OK;
+}
+
 // page class constructor
-void Page::init(int pageNo)
+void Page::init(int pageNo, int flags, int recLen, int colCnt,
+		const short colLen[])
 {
     nextPage = -1;
     slotCnt = 0; // no slots in use
+    freeSlot = 0;
     curPage = pageNo;
+    this->flags = flags;
+    this->recLen = 0;
+
+    // the slot bitmap, the widths of the columns of a PAX page, then
+    // the records of all the slots
+    if (flags & FIXEDREC)
+    {
+	int colBytes = flags & PAX ? columnBytes(colCnt) : 0;
+	int slots = fixedSlots(recLen, PAGEDATASIZE - colBytes);
+	int mapBytes = (slots + 63) / 64 * sizeof(unsigned long long);
+	memset(data, 0, mapBytes);
+	this->recLen = recLen;
+	slotCnt = -slots;
+	freePtr = mapBytes + colBytes;
+	freeSpace = slots * recLen;
+	if (flags & PAX)
+	{
+	    short* cols = (short*)&data[mapBytes];
+	    cols[0] = colCnt;
+	    memcpy(&cols[1], colLen, colCnt * sizeof(short));
+	}
+	return;
+    }
+
     freePtr=0; // offset of free space in data array
 //    freeSpace=PAGESIZE-DPFIXED + sizeof(slot_t); // amount of space available
     freeSpace=PAGESIZE-DPFIXED; // amount of space available
+
+    // the slot bitmap takes the first bytes of data[]
+    if (flags & SLOTMAP)
+    {
+	int mapBytes = slotMapWords() * sizeof(unsigned long long);
+	memset(data, 0, mapBytes);
+	freePtr += mapBytes;
+	freeSpace -= mapBytes;
+    }
+}
+
+// length of the largest record a page initialized with flags holds
+unsigned Page::maxRecLen(const int flags)
+{
+    if (flags & PAX)
+	return PAGEDATASIZE - sizeof(unsigned long long)
+	    - columnBytes(MAXCOLUMNS);
+    if (flags & FIXEDREC)
+	return PAGEDATASIZE - sizeof(unsigned long long);
+
+    unsigned len = PAGESIZE - DPFIXED;
+    if (flags & SLOTMAP)
+	len -= slotMapWords() * sizeof(unsigned long long);
+    return len;
+}
+
+// # of records of length recLen a FIXEDREC page has room for in
+// avail bytes, next to a bitmap with a bit for each
+int Page::fixedSlots(const int recLen, const int avail)
+{
+    int slots = avail * 8 / (recLen * 8 + 1);
+    while ((slots + 63) / 64 * (int)sizeof(unsigned long long)
+	   + slots * recLen > avail)
+	slots--;
+    return slots;
+}
+
+// Return the first slot # from slotNo on, up to the end of the slot
+// array, that is in use if used is true, or free otherwise; the #
+// of slots on the page if there is none. With a slot bitmap, the
+// slots are checked a word at a time.
+int Page::findSlot(int slotNo, const bool used) const
+{
+    int end = -slotCnt;
+
+    if (!(flags & (SLOTMAP | FIXEDREC)))
+    {
+	const slot_t* slot = slotArray();
+	while (slotNo < end && (slot[-slotNo].length != -1) != used)
+	    slotNo++;
+	return slotNo;
+    }
+
+    const unsigned long long* map = (const unsigned long long*)data;
+    while (slotNo < end)
+    {
+	int w = slotNo / 64;
+	unsigned long long bits = used ? map[w] : ~map[w];
+	bits &= ~0ULL << (slotNo % 64);     // skip slots before slotNo
+	if (bits)
+	{
+	    slotNo = w * 64 + __builtin_ctzll(bits);
+	    return slotNo < end ? slotNo : end;
+	}
+	slotNo = (w + 1) * 64;
+    }
+    return end;
 }
 
 // dump page utlity
 void Page::dumpPage() const
 {
+  const slot_t* slot = slotArray();
   int i;
 
   cout << "curPage = " << curPage <<", nextPage = " << nextPage
        << "\nfreePtr = " << freePtr << ",  freeSpace = " << freeSpace 
-       << ", slotCnt = " << slotCnt << endl;
+       << ", slotCnt = " << slotCnt << ", freeSlot = " << freeSlot
+       << ", flags = " << flags << endl;
+
+    if (flags & FIXEDREC)
+    {
+      cout << "recLen = " << recLen << endl;
+      if (flags & PAX)
+      {
+	const short* cols = columns();
+	cout << "columns =";
+	for (i = 1; i <= cols[0]; i++)
+	  cout << " " << cols[i];
+	cout << endl;
+      }
+      for (i = 0; i < -slotCnt; i++)
+	if (slotUsed(i))
+	  cout << "slot[" << i << "].offset = " << freePtr + i * recLen
+	       << endl;
+      return;
+    }
     
     for (i=0;i>slotCnt;i--)
       cout << "slot[" << i << "].offset = " << slot[i].offset 
@@ -54,22 +184,49 @@ const short Page::getFreeSpace() const
 
 const Status Page::insertRecord(const Record & rec, RID& rid)
 {
+    slot_t* slot = slotArray();
     RID tmpRid;
     int spaceNeeded = rec.length + sizeof(slot_t);
 
+    // a FIXEDREC page stores the record in the first free slot
+    if (flags & FIXEDREC)
+    {
+	if (rec.length != recLen) return INVALIDRECLEN;
+	if (freeSpace < recLen) return NOSPACE;
+
+	int i = findSlot(freeSlot, false);
+	if (flags & PAX)
+	{
+	    // each column goes to its minipage
+	    const short* cols = columns();
+	    const char* value = (const char*)rec.data;
+	    char* minipage = &data[freePtr];
+	    for (int c = 1; c <= cols[0]; c++)
+	    {
+		memcpy(minipage + i * cols[c], value, cols[c]);
+		value += cols[c];
+		minipage -= slotCnt * cols[c];
+	    }
+	}
+	else
+	    memcpy(&data[freePtr + i * recLen], rec.data, recLen);
+	((unsigned long long*)data)[i / 64] |= 1ULL << (i % 64);
+	freeSpace -= recLen;
+	freeSlot = i + 1;
+
+	rid.pageNo = curPage;
+	rid.slotNo = i;
+	return OK;
+    }
+
     // Start by checking if sufficient space exists
     // This is an upper bound check. may not actually need a slot
     // if we can find an empty one
     if (spaceNeeded > freeSpace) return NOSPACE;
     else
     {
-        int i=0;
-    	// look for an empty slot
-    	while (i > slotCnt)
-    	{
-	    if (slot[i].length == -1) break;
-	    else i--;
-    	}
+    	// look for an empty slot, from the first one that may be free
+        int i = -findSlot(freeSlot, false);
 	// at this point we have either found an empty slot 
 	// or i will be equal to slotCnt.  In either case,
 	// we can just use i as the slot index
@@ -96,6 +253,11 @@ const Status Page::insertRecord(const Record & rec, RID& rid)
 	memcpy(&data[freePtr], rec.data, rec.length); // copy data on to the data page
 	freePtr += rec.length; // adjust freePtr 
 
+	// all slots up to this one are in use now
+	freeSlot = -i + 1;
+	if (flags & SLOTMAP)
+	    ((unsigned long long*)data)[-i / 64] |= 1ULL << (-i % 64);
+
 	tmpRid.pageNo = curPage;
 	tmpRid.slotNo = -i; // make a positive slot number
 	rid = tmpRid;
@@ -110,8 +272,22 @@ const Status Page::insertRecord(const Record & rec, RID& rid)
 
 const Status Page::deleteRecord(const RID & rid)
 {
+    slot_t* slot = slotArray();
     int	slotNo = -rid.slotNo;   // convert to negative format
 
+    // on a FIXEDREC page the slot is only marked free
+    if (flags & FIXEDREC)
+    {
+	slotNo = rid.slotNo;
+	if (slotNo < 0 || slotNo >= -slotCnt || !slotUsed(slotNo))
+	    return INVALIDSLOTNO;
+	((unsigned long long*)data)[slotNo / 64] &= ~(1ULL << (slotNo % 64));
+	freeSpace += recLen;
+	if (slotNo < freeSlot)
+	    freeSlot = slotNo;
+	return OK;
+    }
+
     // first check if the record being deleted is actually valid
     if ((slotNo > slotCnt) && (slot[slotNo].length > 0))
     {
@@ -161,20 +337,28 @@ const Status Page::deleteRecord(const RID & rid)
 	    freePtr -= recLen;  // back up free pointer
 	    freeSpace += recLen;  // increase freespace by size of hole
 
+	    if (flags & SLOTMAP)
+		((unsigned long long*)data)[-slotNo / 64]
+		    &= ~(1ULL << (-slotNo % 64));
+	    if (-slotNo < freeSlot)
+		freeSlot = -slotNo;
+
 	    // Now there are two cases:
 	    if (slotNo == slotCnt + 1)
-
-	      // Case 1 : Slot being freed is at end of slot array. In this
-	      //          case we can compact the slot array. Note that we
-	      //          should even compact slots that might have been
-	      //          emptied previously.
-	      do
-		{
-		  slotCnt++;
-		  freeSpace += sizeof(slot_t);
-		}
-	      while (slotCnt < 0 && slot[slotCnt + 1].length == -1);
-
+	      {
+		// Case 1 : Slot being freed is at end of slot array. In this
+		//          case we can compact the slot array. Note that we
+		//          should even compact slots that might have been
+		//          emptied previously.
+		do
+		  {
+		    slotCnt++;
+		    freeSpace += sizeof(slot_t);
+		  }
+		while (slotCnt < 0 && slot[slotCnt + 1].length == -1);
+		if (freeSlot > -slotCnt)
+		  freeSlot = -slotCnt;
+	      }
 	    else
 	      {
 		// Case 2: Slot being freed is in middle of slot array. No
@@ -192,15 +376,10 @@ const Status Page::deleteRecord(const RID & rid)
 const Status Page::firstRecord(RID& firstRid) const
 {
     RID tmpRid;
-    int i=0;
 
     // find the first non-empty slot
-    while (i > slotCnt)
-    {
-	if (slot[i].length == -1) i--;
-	else break;
-    }
-    if ((i == slotCnt) || (slot[i].length == -1)) return NORECORDS;
+    int i = -findSlot(0, true);
+    if (i == slotCnt) return NORECORDS;
     else
     {
 	// found a non-empty slot
@@ -216,17 +395,11 @@ const Status Page::firstRecord(RID& firstRid) const
 const Status Page::nextRecord (const RID &curRid, RID& nextRid) const
 {
     RID tmpRid;
-    int i; 
 
-    i = -curRid.slotNo; // get current slot number
-    i--; // back up one position
-    // find the first non-empty slot
-    while (i > slotCnt)
-    {
-	if (slot[i].length == -1) i--;
-	else break;
-    }
-    if ((i <= slotCnt) || (slot[i].length == -1)) return ENDOFPAGE;
+    // find the first non-empty slot after the current one
+    if (curRid.slotNo + 1 >= -slotCnt) return ENDOFPAGE;
+    int i = -findSlot(curRid.slotNo + 1, true);
+    if (i <= slotCnt) return ENDOFPAGE;
     else
     {
 	// found a non-empty slot
@@ -237,12 +410,40 @@ const Status Page::nextRecord (const RID &curRid, RID& nextRid) const
     }
 }
 
-// returns length and pointer to record with RID rid
-const Status Page::getRecord(const RID & rid, Record & rec)
+// returns length and pointer to record with RID rid. The columns of
+// a record of a PAX page are copied to buf, which rec then points to.
+const Status Page::getRecord(const RID & rid, Record & rec, char* buf)
 {
+    slot_t* slot = slotArray();
     int	slotNo = rid.slotNo;
     int offset;
 
+    // the record of a FIXEDREC page is found from its slot # alone
+    if (flags & FIXEDREC)
+    {
+	if (slotNo < 0 || slotNo >= -slotCnt || !slotUsed(slotNo))
+	    return INVALIDSLOTNO;
+	rec.length = recLen;
+	if (!(flags & PAX))
+	{
+	    rec.data = &data[freePtr + slotNo * recLen];
+	    return OK;
+	}
+
+	if (!buf) return BADRECPTR;
+	const short* cols = columns();
+	const char* minipage = &data[freePtr];
+	char* value = buf;
+	for (int c = 1; c <= cols[0]; c++)
+	{
+	    memcpy(value, minipage + slotNo * cols[c], cols[c]);
+	    value += cols[c];
+	    minipage -= slotCnt * cols[c];
+	}
+	rec.data = buf;
+	return OK;
+    }
+
     if (((-slotNo) > slotCnt) && (slot[-slotNo].length > 0))
     {
         offset = slot[-slotNo].offset; // extract offset in data[]
@@ -252,3 +453,38 @@ const Status Page::getRecord(const RID & rid, Record & rec)
     }
     else return INVALIDSLOTNO;
 }
+
+// returns pointer to the length bytes at offset of the record with
+// RID rid. On a PAX page they are found in the minipage of the column
+// they are in; BADFIELD if they span columns or pass the end of the
+// record.
+const Status Page::getField(const RID & rid, const int offset,
+			    const int length, const char*& field)
+{
+    if (!(flags & PAX))
+    {
+	Record rec;
+	Status status = getRecord(rid, rec);
+	if (status != OK) return status;
+	if (offset < 0 || offset + length > rec.length) return BADFIELD;
+	field = (const char*)rec.data + offset;
+	return OK;
+    }
+
+    int slotNo = rid.slotNo;
+    if (slotNo < 0 || slotNo >= -slotCnt || !slotUsed(slotNo))
+	return INVALIDSLOTNO;
+
+    // find the column, at colOff in the record
+    const short* cols = columns();
+    int colOff = 0;
+    int c = 1;
+    while (c <= cols[0] && colOff + cols[c] <= offset)
+	colOff += cols[c++];
+    if (c > cols[0] || offset < 0 || offset + length > colOff + cols[c])
+	return BADFIELD;
+
+    field = &data[freePtr - slotCnt * colOff + slotNo * cols[c]
+		  + offset - colOff];
+    return OK;
+}
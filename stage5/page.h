@@ -1,6 +1,7 @@
 #ifndef PAGE_H
 #define PAGE_H
 
+#include <stddef.h>
 #include "error.h"
 
 struct RID{
@@ -22,31 +23,120 @@ struct slot_t {
         short	length;  // equals -1 if slot is not in use
 };
 
-const unsigned PAGESIZE = 1024;
-const unsigned DPFIXED= sizeof(slot_t)+4*sizeof(short)+2*sizeof(int);
-const unsigned PAGEDATASIZE = PAGESIZE-DPFIXED+sizeof(slot_t);
+// The page size is chosen when a database is created and is the same
+// for all of its files. PAGESIZE is the page size of the database in
+// use; it must be set with setPageSize() before the buffer manager
+// is created or any file is opened. Slot offsets are shorts, which
+// limits pages to 32 KB.
+
+const unsigned MINPAGESIZE = 1024;
+const unsigned MAXPAGESIZE = 32768;
+const unsigned DEFPAGESIZE = 1024;
+
+extern unsigned PAGESIZE;
+extern const Status setPageSize(const unsigned pageSize);
+
+const unsigned DPFIXED= sizeof(slot_t)+4*sizeof(short)+4*sizeof(int);
+#define PAGEDATASIZE (PAGESIZE-DPFIXED+sizeof(slot_t))
 // size of the data area of a page
 
+// page flags, set by init. A page with SLOTMAP keeps a bitmap of the
+// slots in use at the start of data[], with a bit for every slot the
+// page could possibly have, so free slots and records are found a
+// word of 64 slots at a time.
+//
+// A FIXEDREC page holds records of one length, given to init, for
+// relations whose records all have the same width. There is no slot
+// array: the records follow the slot bitmap as an array indexed by
+// slot #, every slot exists from the start, and a delete only clears
+// the slot's bit.
+//
+// A PAX page is a FIXEDREC page that stores the records by column:
+// the values of each column of all the slots are kept together in a
+// minipage, so a scan that looks at one column touches only its
+// minipage. The widths of the columns, at most MAXCOLUMNS, are given
+// to init and kept on the page after the slot bitmap. A record is not
+// stored in one piece, so getRecord gathers it into a buffer.
+
+const int SLOTMAP = 1;
+const int FIXEDREC = 2;
+const int PAX = 4;
+
+const int MAXCOLUMNS = 40;
+
 // Class definition for a minirel data page.   
 // The design assumes that records are kept compacted when
 // deletions are performed. Notice, however, that the slot
 // array cannot be compacted.  Notice, this class does not keep
 // the records align, relying instead on upper levels to take
 // care of non-aligned attributes
+//
+// A page occupies PAGESIZE bytes. The fixed fields come first, data[]
+// extends to the end of the page, and the slot array grows backwards
+// from the end of the page into data[]. sizeof(Page) is therefore only
+// the smallest page size; pages must be allocated with PAGESIZE bytes.
+//
+// All slots below freeSlot are in use, so an insert looks for a free
+// slot from there on and a page without holes finds none at once.
+//
+// On a FIXEDREC page, -slotCnt is the # of slots the page has room
+// for, freePtr the offset of the record of slot 0 in data[] and
+// freeSpace the bytes of the free slots. On a PAX page, freePtr is
+// the offset of the first minipage; the minipage of the column that
+// starts at byte off of a record starts at freePtr - slotCnt * off.
 
 class Page {
 private:
-    char 	data[PAGESIZE - DPFIXED]; 
-    slot_t 	slot[1]; // first element of slot array - grows backwards!
     short	slotCnt; // number of slots in use;
     short	freePtr; // offset of first free byte in data[]
     short	freeSpace; // number of bytes free in data[]
-    short	dummy;	// for alignment purposes
+    short	freeSlot; // lowest slot # that may be free
     int		nextPage; // forwards pointer
     int		curPage;  // page number of current pointer
+    int		flags;	  // SLOTMAP, FIXEDREC, or 0
+    int		recLen;	  // length of records of a FIXEDREC page
+    char 	data[MINPAGESIZE - DPFIXED + sizeof(slot_t)];
+
+    // first element of slot array, in the last bytes of the page
+    slot_t* slotArray()
+    {
+	return (slot_t*)((char*)this + PAGESIZE) - 1;
+    }
+    const slot_t* slotArray() const
+    {
+	return (const slot_t*)((const char*)this + PAGESIZE) - 1;
+    }
+
+    static int slotMapWords()	// # of 64-bit words of a slot bitmap
+    {
+	return ((PAGESIZE - DPFIXED) / sizeof(slot_t) + 64) / 64;
+    }
+    static int fixedSlots(const int recLen, const int avail);
+				// # of slots of a FIXEDREC page
+    static int columnBytes(const int colCnt)	// space of PAX widths
+    {
+	return (int)(sizeof(short) * (colCnt + 1) + 7) & ~7;
+    }
+    const short* columns() const	// # of columns, then widths
+    {
+	return (const short*)&data[(-slotCnt + 63) / 64
+				   * sizeof(unsigned long long)];
+    }
+    int findSlot(int slotNo, const bool used) const;
+			// first slot from slotNo on that is in use or free
+    bool slotUsed(const int slotNo) const	// bit of slot in bitmap
+    {
+	return ((const unsigned long long*)data)[slotNo / 64]
+	    >> (slotNo % 64) & 1;
+    }
 
 public:
-    void init(const int pageNo); // initialize a new page
+    // initialize a new page; recLen is the record length of a
+    // FIXEDREC page, colLen the widths of the colCnt columns of a PAX
+    // page
+    void init(const int pageNo, const int flags = 0, const int recLen = 0,
+	      const int colCnt = 0, const short colLen[] = NULL);
+    static unsigned maxRecLen(const int flags); // largest record that fits
     void dumpPage() const;       // dump contents of a page
 
     const Status getNextPage(int& pageNo) const; // returns value of nextPage
@@ -67,8 +157,14 @@ public:
     // returns ENDOFPAGE if no more records exist on the page
     const Status nextRecord (const RID & curRid, RID& nextRid) const;
 
-    // returns reference to record with RID rid
-    const Status getRecord(const RID & rid, Record & rec);
+    // returns reference to record with RID rid; the record of a PAX
+    // page is copied to buf
+    const Status getRecord(const RID & rid, Record & rec, char* buf = NULL);
+
+    // returns pointer to the length bytes at offset of the record
+    // with RID rid; on a PAX page they must be within one column
+    const Status getField(const RID & rid, const int offset,
+			  const int length, const char*& field);
 };
 
 #endif
@@ -57,6 +57,9 @@ typedef enum {
     N_LOAD,
     N_PRINT,
     N_HELP,
+    N_SET,
+    N_STATS,
+    N_VACUUM,
     N_SELECT,
     N_JOIN,
     N_PRIMATTR,
@@ -101,6 +104,7 @@ typedef struct node {
 	    char *relname;
 	    struct node *attrlist;
 	    struct node *primattr;
+	    char *layout;
 	} CREATE;
 
 	// destroy node */
@@ -137,6 +141,25 @@ typedef struct node {
 	    char *relname;
 	} HELP;
 
+	// set node */
+	struct {
+	    char *name;
+	    int value;
+	    char *unit;
+	} SET;
+
+	// stats node */
+	struct {
+	    char *relname;
+	    char *filename;
+	} STATS;
+
+	// vacuum node */
+	struct {
+	    char *relname;
+	    int pages;
+	} VACUUM;
+
 	// select node */
 	struct {
 	    struct node *selattr;
@@ -215,7 +238,8 @@ NODE *newnode(int kind);
 NODE *query_node(char *relname, NODE *attrlist, NODE *n);
 NODE *insert_node(char *relname, NODE *attrlist);
 NODE *delete_node(char *relname, NODE *qual);
-NODE *create_node(char *relname, NODE *attrlist, NODE *primattr);
+NODE *create_node(char *relname, NODE *attrlist, NODE *primattr,
+		  char *layout);
 NODE *destroy_node(char *relname);
 NODE *build_node(char *relname, char *attrname, int nbuckets);
 NODE *rebuild_node(char *relname, char *attrname, int nbuckets);
@@ -223,6 +247,9 @@ NODE *drop_node(char *relname, char *attrname);
 NODE *load_node(char *relname, char *filename);
 NODE *print_node(char *relname);
 NODE *help_node(char *relname);
+NODE *set_node(char *name, int value, char *unit);
+NODE *stats_node(char *relname, char *filename);
+NODE *vacuum_node(char *relname, int pages);
 NODE *select_node(NODE *selattr, int op, NODE *value);
 NODE *join_node(NODE *joinattr1, int op, NODE *joinattr2);
 NODE *qualattr_node(char *relname, char *attrname);
@@ -36,6 +36,10 @@ static NODE *parse_tree;                // root of parse tree
 		RW_LOAD
 		RW_HELP
 		RW_QUIT
+		RW_SET
+		RW_STATS
+		RW_LAYOUT
+		RW_VACUUM
 		RW_SELECT
 		RW_INTO
 		RW_WHERE
@@ -77,6 +81,9 @@ static NODE *parse_tree;                // root of parse tree
 %type	<sval>	opt_into_relname
 		opt_relname
 		string
+		opt_unit
+		opt_into_file
+		opt_layout
 
 %type	<n>	command
 		query
@@ -92,6 +99,9 @@ static NODE *parse_tree;                // root of parse tree
 		load
 		print
 		help
+		set
+		stats
+		vacuum
 		quit
 		opt_primary_attr
 		opt_where
@@ -155,6 +165,9 @@ command
 	| load
 	| print
 	| help
+	| set
+	| stats
+	| vacuum
 	| quit
 	| nothing
 	{
@@ -257,8 +270,9 @@ delete
 
 create
 	: RW_CREATE RW_TABLE string '(' non_mt_attrtype_list ')' opt_primary_attr
+	  opt_layout
 	{
-		$$ = create_node($3, $5, $7);
+		$$ = create_node($3, $5, $7, $8);
 	}
 	;
 
@@ -316,6 +330,31 @@ help
 	}
 	;
 
+set
+	: RW_SET string T_EQ T_INT opt_unit
+	{
+		$$ = set_node($2, $4, $5);
+	}
+	;
+
+stats
+	: RW_STATS opt_relname opt_into_file
+	{
+		$$ = stats_node($2, $3);
+	}
+	;
+
+vacuum
+	: RW_VACUUM string
+	{
+		$$ = vacuum_node($2, 0);
+	}
+	| RW_VACUUM string T_INT
+	{
+		$$ = vacuum_node($2, $3);
+	}
+	;
+
 quit
 	: RW_QUIT ';'
 	{
@@ -356,6 +395,39 @@ opt_relname
 	}
 	;
 	
+opt_unit
+	: string
+	{
+		$$ = $1;
+	}
+	| nothing
+	{
+		$$ = NULL;
+	}
+	;
+
+opt_into_file
+	: RW_INTO '(' T_QSTRING ')'
+	{
+		$$ = $3;
+	}
+	| nothing
+	{
+		$$ = NULL;
+	}
+	;
+
+opt_layout
+	: RW_LAYOUT T_EQ string
+	{
+		$$ = $3;
+	}
+	| nothing
+	{
+		$$ = NULL;
+	}
+	;
+
 opt_where
 	: RW_WHERE qual
 	{
@@ -55,7 +55,7 @@ Partition::Partition(HeapFileScan *rel,
     s << "/tmp/" << fileName << '.' << p << ends;
     partName[p] = s.str();
 
-    if (!(part[p] = new InsertFileScan(partName[p], status))) {
+    if (!(part[p] = new InsertFileScan(partName[p], status, true))) {
       status = INSUFMEM;
       return;
     }
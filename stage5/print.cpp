@@ -98,7 +98,7 @@ const Status UT_Print(string relation)
     return status;
 
   // open data file
-  HeapFileScan *hfile = new HeapFileScan(rd.relName, status);
+  HeapFileScan *hfile = new HeapFileScan(rd.relName, status, ScanMode);
   if (!hfile) return INSUFMEM;
   if (status != OK) return status;
 
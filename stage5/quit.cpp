@@ -22,11 +22,23 @@ extern AttrCatalog *attrCat;
 
 void UT_Quit(void)
 {
+  // save the list of pages in the pool while the catalogs, and so
+  // their pages, are still open
+
+  Status status = bufMgr->dumpPool(POOLLISTNAME);
+  if (status != OK)
+    error.print(status);
+
   // close relcat and attrcat
 
   delete relCat;
   delete attrCat;
 
+  // make the tuples of an unfinished insert batch durable
+
+  if ((status = bufMgr->flushAll(true)) != OK)
+    error.print(status);
+
   // delete bufMgr to flush out all dirty pages
 
   delete bufMgr;
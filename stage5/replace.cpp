@@ -0,0 +1,841 @@
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <iostream>
+#include "page.h"
+#include "buf.h"
+
+// Buffer replacement policies: CLOCK, LRU-2 (O'Neil et al., with a
+// history of recently replaced pages), 2Q (Johnson and Shasha, the
+// full version with A1in, A1out and Am) and ARC (Megiddo and Modha).
+
+
+// Doubly linked lists threaded through arrays indexed by node. The
+// head of a list holds its most recently used node and the tail the
+// least recently used one. A node is on at most one list.
+
+class NodeLists
+{
+ public:
+  NodeLists(const int nodes, const int lists);
+  ~NodeLists();
+
+  void pushHead(const int list, const int node);
+  void pushTail(const int list, const int node);
+  void insertNewer(const int node, const int at); // just newer than at
+  void unlink(const int node);                    // take off its list
+
+  int head(const int list) const { return heads[list]; }
+  int tail(const int list) const { return tails[list]; }
+  int size(const int list) const { return sizes[list]; }
+  int owner(const int node) const { return owners[node]; } // -1 if none
+  int newer(const int node) const { return newerOf[node]; }
+  int older(const int node) const { return olderOf[node]; }
+
+ private:
+  int* newerOf;
+  int* olderOf;
+  int* owners;
+  int* heads;
+  int* tails;
+  int* sizes;
+
+  void link(const int list, const int node, const int newerNode,
+	    const int olderNode);
+};
+
+
+NodeLists::NodeLists(const int nodes, const int lists)
+{
+  newerOf = new int[nodes];
+  olderOf = new int[nodes];
+  owners = new int[nodes];
+  for (int i = 0; i < nodes; i++)
+    newerOf[i] = olderOf[i] = owners[i] = -1;
+  heads = new int[lists];
+  tails = new int[lists];
+  sizes = new int[lists];
+  for (int i = 0; i < lists; i++) {
+    heads[i] = tails[i] = -1;
+    sizes[i] = 0;
+  }
+}
+
+
+NodeLists::~NodeLists()
+{
+  delete [] newerOf;
+  delete [] olderOf;
+  delete [] owners;
+  delete [] heads;
+  delete [] tails;
+  delete [] sizes;
+}
+
+
+void NodeLists::link(const int list, const int node, const int newerNode,
+		     const int olderNode)
+{
+  owners[node] = list;
+  newerOf[node] = newerNode;
+  olderOf[node] = olderNode;
+  if (newerNode >= 0)
+    olderOf[newerNode] = node;
+  else
+    heads[list] = node;
+  if (olderNode >= 0)
+    newerOf[olderNode] = node;
+  else
+    tails[list] = node;
+  sizes[list]++;
+}
+
+
+void NodeLists::pushHead(const int list, const int node)
+{
+  unlink(node);
+  link(list, node, -1, heads[list]);
+}
+
+
+void NodeLists::pushTail(const int list, const int node)
+{
+  unlink(node);
+  link(list, node, tails[list], -1);
+}
+
+
+void NodeLists::insertNewer(const int node, const int at)
+{
+  unlink(node);
+  link(owners[at], node, newerOf[at], at);
+}
+
+
+void NodeLists::unlink(const int node)
+{
+  int list = owners[node];
+  if (list < 0)
+    return;
+  if (newerOf[node] >= 0)
+    olderOf[newerOf[node]] = olderOf[node];
+  else
+    heads[list] = olderOf[node];
+  if (olderOf[node] >= 0)
+    newerOf[olderOf[node]] = newerOf[node];
+  else
+    tails[list] = newerOf[node];
+  sizes[list]--;
+  owners[node] = newerOf[node] = olderOf[node] = -1;
+}
+
+
+// Pages that were replaced recently, kept on one or more lists of
+// their own and found by (file, pageNo). Used by LRU-2 for the
+// reference history of replaced pages and by 2Q and ARC for their
+// ghost lists. Adding a page to a full directory forgets the oldest
+// page of the same list, or of another one if that list is empty.
+
+class GhostDir
+{
+ public:
+  GhostDir(const int capacity, const int lists);
+  ~GhostDir();
+
+  int find(const File* file, const int pageNo); // entry or -1
+  void add(const int list, const File* file, const int pageNo,
+	   const unsigned long stamp = 0);
+  void remove(const int entry);
+  void dropOldest(const int list);
+
+  int list(const int entry) const { return ghosts.owner(entry); }
+  int size(const int list) const { return ghosts.size(list); }
+  unsigned long stamp(const int entry) const { return stamps[entry]; }
+
+ private:
+  int freeList;                 // list of unused entries
+  BufHashTbl index;             // (file, pageNo) -> entry
+  NodeLists ghosts;
+  const File** files;
+  int* pageNos;
+  unsigned long* stamps;
+};
+
+
+GhostDir::GhostDir(const int capacity, const int lists)
+  : freeList(lists), index(capacity), ghosts(capacity, lists + 1)
+{
+  files = new const File* [capacity];
+  pageNos = new int[capacity];
+  stamps = new unsigned long[capacity];
+  for (int i = 0; i < capacity; i++)
+    ghosts.pushHead(freeList, i);
+}
+
+
+GhostDir::~GhostDir()
+{
+  delete [] files;
+  delete [] pageNos;
+  delete [] stamps;
+}
+
+
+int GhostDir::find(const File* file, const int pageNo)
+{
+  int entry;
+  if (index.lookup(file, pageNo, entry) != OK)
+    return -1;
+  return entry;
+}
+
+
+void GhostDir::add(const int list, const File* file, const int pageNo,
+		   const unsigned long stamp)
+{
+  int entry = find(file, pageNo);
+  if (entry >= 0)
+    remove(entry);
+  for (int l = list; ghosts.size(freeList) == 0 && l < list + freeList; l++)
+    dropOldest(l % freeList);
+  entry = ghosts.tail(freeList);
+  if (entry < 0 || index.insert(file, pageNo, entry) != OK)
+    return;
+  files[entry] = file;
+  pageNos[entry] = pageNo;
+  stamps[entry] = stamp;
+  ghosts.pushHead(list, entry);
+}
+
+
+void GhostDir::remove(const int entry)
+{
+  (void)index.remove(files[entry], pageNos[entry]);
+  ghosts.pushHead(freeList, entry);
+}
+
+
+void GhostDir::dropOldest(const int list)
+{
+  int entry = ghosts.tail(list);
+  if (entry >= 0)
+    remove(entry);
+}
+
+
+// CLOCK: a reference bit per frame, set when the page is referenced.
+// The hand sweeps over the frames, clearing set bits and offering
+// frames whose bit is clear.
+
+class ClockReplacer : public Replacer
+{
+ public:
+  ClockReplacer(const int frames);
+  ~ClockReplacer();
+
+  void loaded(const int frame, const File* file, const int pageNo,
+	      const bool referenced);
+  void touched(const int frame);
+  void replaced(const int frame);
+  void dropped(const int frame);
+  int victim(ReplCursor & cursor);
+  int upcoming(ReplCursor & cursor);
+
+ private:
+  int frames;
+  unsigned int hand;
+  bool* refbit;
+};
+
+
+ClockReplacer::ClockReplacer(const int frames)
+{
+  this->frames = frames;
+  hand = frames - 1;
+  refbit = new bool[frames];
+  memset(refbit, 0, frames * sizeof(bool));
+}
+
+
+ClockReplacer::~ClockReplacer()
+{
+  delete [] refbit;
+}
+
+
+void ClockReplacer::loaded(const int frame, const File* file,
+			   const int pageNo, const bool referenced)
+{
+  __atomic_store_n(&refbit[frame], referenced, __ATOMIC_RELAXED);
+}
+
+
+void ClockReplacer::touched(const int frame)
+{
+  __atomic_store_n(&refbit[frame], true, __ATOMIC_RELAXED);
+}
+
+
+void ClockReplacer::replaced(const int frame)
+{
+  __atomic_store_n(&refbit[frame], false, __ATOMIC_RELAXED);
+}
+
+
+void ClockReplacer::dropped(const int frame)
+{
+  __atomic_store_n(&refbit[frame], false, __ATOMIC_RELAXED);
+}
+
+
+// Two sweeps over the pool are enough to clear every reference bit.
+
+int ClockReplacer::victim(ReplCursor & cursor)
+{
+  while (cursor.steps < 2 * frames) {
+    cursor.steps++;
+    int frame = __atomic_add_fetch(&hand, 1, __ATOMIC_RELAXED) % frames;
+    if (!__atomic_load_n(&refbit[frame], __ATOMIC_RELAXED))
+      return frame;
+    __atomic_store_n(&refbit[frame], false, __ATOMIC_RELAXED);
+  }
+  return -1;
+}
+
+
+// The frames ahead of the hand whose bit is clear, in the order the
+// hand will reach them.
+
+int ClockReplacer::upcoming(ReplCursor & cursor)
+{
+  if (cursor.steps == 0)
+    cursor.frame = __atomic_load_n(&hand, __ATOMIC_RELAXED) % frames;
+  while (cursor.steps < frames) {
+    cursor.steps++;
+    int frame = cursor.frame = (cursor.frame + 1) % frames;
+    if (!__atomic_load_n(&refbit[frame], __ATOMIC_RELAXED))
+      return frame;
+  }
+  return -1;
+}
+
+
+// Common part of the policies that keep the frames on lists. Frames
+// without a page are on the free list and are offered first; then
+// each list named by order() is walked. All state is protected by
+// one lock.
+
+class ListReplacer : public Replacer
+{
+ public:
+  ListReplacer(const int frames, const int lists);
+  ~ListReplacer();
+
+  void loaded(const int frame, const File* file, const int pageNo,
+	      const bool referenced);
+  void touched(const int frame);
+  void replaced(const int frame);
+  void dropped(const int frame);
+  int victim(ReplCursor & cursor);
+
+ protected:
+  enum { FREE = 0 };
+
+  int frames;
+  NodeLists lists;
+  const File** files;           // page held by each frame
+  int* pageNos;
+
+  // the policy proper, called under the lock
+  virtual void load(const int frame) = 0;   // files/pageNos[frame] set
+  virtual void touch(const int frame) = 0;
+  virtual void evict(const int frame) = 0;  // before frame is freed
+  virtual void forget(const int frame) {}   // frame is being freed
+  virtual int order(int lists[]) = 0;       // lists to offer, in order
+
+  // walk of a list in the order its frames are offered, from the
+  // tail unless the policy keeps the list in another structure
+  virtual int first(const int list)
+  {
+    return lists.tail(list);
+  }
+  virtual int next(const int list, const int frame)
+  {
+    return lists.owner(frame) == list ? lists.newer(frame) : first(list);
+  }
+
+ private:
+  pthread_mutex_t lock;
+  bool* unreferenced;           // read ahead and not used yet
+};
+
+
+ListReplacer::ListReplacer(const int frames, const int lists)
+  : lists(frames, lists)
+{
+  this->frames = frames;
+  files = new const File* [frames];
+  pageNos = new int[frames];
+  unreferenced = new bool[frames];
+  for (int i = frames - 1; i >= 0; i--) {
+    files[i] = NULL;
+    pageNos[i] = -1;
+    unreferenced[i] = false;
+    this->lists.pushHead(FREE, i);
+  }
+  pthread_mutex_init(&lock, NULL);
+}
+
+
+ListReplacer::~ListReplacer()
+{
+  pthread_mutex_destroy(&lock);
+  delete [] files;
+  delete [] pageNos;
+  delete [] unreferenced;
+}
+
+
+void ListReplacer::loaded(const int frame, const File* file,
+			  const int pageNo, const bool referenced)
+{
+  pthread_mutex_lock(&lock);
+  files[frame] = file;
+  pageNos[frame] = pageNo;
+  unreferenced[frame] = !referenced;
+  load(frame);
+  pthread_mutex_unlock(&lock);
+}
+
+
+void ListReplacer::touched(const int frame)
+{
+  pthread_mutex_lock(&lock);
+  if (unreferenced[frame])
+    unreferenced[frame] = false;
+  else if (lists.owner(frame) != FREE)
+    touch(frame);
+  pthread_mutex_unlock(&lock);
+}
+
+
+void ListReplacer::replaced(const int frame)
+{
+  pthread_mutex_lock(&lock);
+  if (lists.owner(frame) != FREE)
+    evict(frame);
+  forget(frame);
+  lists.pushTail(FREE, frame);
+  files[frame] = NULL;
+  pthread_mutex_unlock(&lock);
+}
+
+
+void ListReplacer::dropped(const int frame)
+{
+  pthread_mutex_lock(&lock);
+  forget(frame);
+  lists.pushTail(FREE, frame);
+  files[frame] = NULL;
+  pthread_mutex_unlock(&lock);
+}
+
+
+// Walk the lists one after the other. If the last frame offered has
+// moved to another list in the meantime, the walk of the current
+// list starts over.
+
+int ListReplacer::victim(ReplCursor & cursor)
+{
+  int order[4];
+  int frame = -1;
+
+  pthread_mutex_lock(&lock);
+  int count = this->order(order + 1) + 1;
+  order[0] = FREE;
+
+  if (cursor.steps < 2 * frames && cursor.list < count) {
+    if (cursor.list < 0) {
+      cursor.list = 0;
+      frame = first(order[0]);
+    }
+    else
+      frame = next(order[cursor.list], cursor.frame);
+
+    while (frame < 0 && ++cursor.list < count)
+      frame = first(order[cursor.list]);
+    if (frame >= 0) {
+      cursor.steps++;
+      cursor.frame = frame;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  return frame;
+}
+
+
+// LRU-2 replaces the page whose second most recent reference is
+// oldest. Pages referenced only once come first, least recently used
+// first, then pages referenced twice, which are kept in a heap
+// ordered by their second most recent reference and offered in heap
+// order: the best victim first, the others roughly in order. The
+// last reference of replaced pages is remembered, so a page read in
+// again soon counts its earlier reference.
+
+class LRU2Replacer : public ListReplacer
+{
+ public:
+  LRU2Replacer(const int frames)
+    : ListReplacer(frames, 3), history(frames, 1)
+  {
+    now = 0;
+    heapSize = 0;
+    last = new unsigned long[frames];
+    prev = new unsigned long[frames];
+    heap = new int[frames];
+    heapPos = new int[frames];
+    for (int i = 0; i < frames; i++)
+      heapPos[i] = -1;
+  }
+  ~LRU2Replacer()
+  {
+    delete [] last;
+    delete [] prev;
+    delete [] heap;
+    delete [] heapPos;
+  }
+
+ protected:
+  enum { ONCE = 1, TWICE = 2 };
+
+  void load(const int frame);
+  void touch(const int frame);
+  void evict(const int frame);
+  void forget(const int frame);
+  int order(int lists[]);
+  int first(const int list);
+  int next(const int list, const int frame);
+
+ private:
+  unsigned long now;            // logical time of last reference
+  unsigned long* last;          // time of last reference of each frame
+  unsigned long* prev;          // and of the one before, 0 if none
+  int* heap;                    // frames on TWICE, a min-heap on prev
+  int* heapPos;                 // index of frame in heap, -1 if none
+  int heapSize;
+  GhostDir history;
+
+  void place(const int frame, const int pos);
+  void siftUp(int pos);
+  void siftDown(int pos);
+  void heapRemove(const int frame);
+};
+
+
+void LRU2Replacer::load(const int frame)
+{
+  int entry = history.find(files[frame], pageNos[frame]);
+  last[frame] = ++now;
+  if (entry >= 0) {
+    prev[frame] = history.stamp(entry);
+    history.remove(entry);
+    lists.unlink(frame);
+    place(frame, heapSize++);
+    siftUp(heapPos[frame]);
+  }
+  else {
+    prev[frame] = 0;
+    lists.pushHead(ONCE, frame);
+  }
+}
+
+
+// A reference makes the key of a frame on TWICE grow, so it sinks in
+// the heap.
+
+void LRU2Replacer::touch(const int frame)
+{
+  prev[frame] = last[frame];
+  last[frame] = ++now;
+  if (heapPos[frame] >= 0)
+    siftDown(heapPos[frame]);
+  else {
+    lists.unlink(frame);
+    place(frame, heapSize++);
+    siftUp(heapPos[frame]);
+  }
+}
+
+
+void LRU2Replacer::evict(const int frame)
+{
+  history.add(0, files[frame], pageNos[frame], last[frame]);
+}
+
+
+void LRU2Replacer::forget(const int frame)
+{
+  if (heapPos[frame] >= 0)
+    heapRemove(frame);
+}
+
+
+int LRU2Replacer::order(int lists[])
+{
+  lists[0] = ONCE;
+  lists[1] = TWICE;
+  return 2;
+}
+
+
+int LRU2Replacer::first(const int list)
+{
+  if (list != TWICE)
+    return ListReplacer::first(list);
+  return heapSize > 0 ? heap[0] : -1;
+}
+
+
+int LRU2Replacer::next(const int list, const int frame)
+{
+  if (list != TWICE)
+    return ListReplacer::next(list, frame);
+  if (heapPos[frame] < 0)
+    return first(list);
+  return heapPos[frame] + 1 < heapSize ? heap[heapPos[frame] + 1] : -1;
+}
+
+
+void LRU2Replacer::place(const int frame, const int pos)
+{
+  heap[pos] = frame;
+  heapPos[frame] = pos;
+}
+
+
+void LRU2Replacer::siftUp(int pos)
+{
+  int frame = heap[pos];
+  while (pos > 0 && prev[heap[(pos - 1) / 2]] > prev[frame]) {
+    place(heap[(pos - 1) / 2], pos);
+    pos = (pos - 1) / 2;
+  }
+  place(frame, pos);
+}
+
+
+void LRU2Replacer::siftDown(int pos)
+{
+  int frame = heap[pos];
+  for (;;) {
+    int child = 2 * pos + 1;
+    if (child >= heapSize)
+      break;
+    if (child + 1 < heapSize && prev[heap[child + 1]] < prev[heap[child]])
+      child++;
+    if (prev[heap[child]] >= prev[frame])
+      break;
+    place(heap[child], pos);
+    pos = child;
+  }
+  place(frame, pos);
+}
+
+
+void LRU2Replacer::heapRemove(const int frame)
+{
+  int pos = heapPos[frame];
+  heapPos[frame] = -1;
+  if (--heapSize == pos)
+    return;
+  int moved = heap[heapSize];
+  place(moved, pos);
+  siftDown(pos);
+  siftUp(heapPos[moved]);
+}
+
+
+// 2Q: pages read in go to the FIFO A1in. Pages replaced from A1in
+// are remembered on A1out, and a page found there when it is read
+// in again goes to the LRU list Am. A1in is kept to a quarter of the
+// pool and A1out remembers half as many pages as the pool holds.
+
+class TwoQReplacer : public ListReplacer
+{
+ public:
+  TwoQReplacer(const int frames)
+    : ListReplacer(frames, 3),
+      out(frames / 2 > 0 ? frames / 2 : 1, 1)
+  {
+    kin = frames / 4 > 0 ? frames / 4 : 1;
+  }
+
+ protected:
+  enum { A1IN = 1, AM = 2 };
+
+  void load(const int frame);
+  void touch(const int frame);
+  void evict(const int frame);
+  int order(int lists[]);
+
+ private:
+  int kin;                      // target size of A1in
+  GhostDir out;                 // A1out
+};
+
+
+void TwoQReplacer::load(const int frame)
+{
+  int entry = out.find(files[frame], pageNos[frame]);
+  if (entry >= 0) {
+    out.remove(entry);
+    lists.pushHead(AM, frame);
+  }
+  else
+    lists.pushHead(A1IN, frame);
+}
+
+
+void TwoQReplacer::touch(const int frame)
+{
+  if (lists.owner(frame) == AM)
+    lists.pushHead(AM, frame);
+}
+
+
+void TwoQReplacer::evict(const int frame)
+{
+  if (lists.owner(frame) == A1IN)
+    out.add(0, files[frame], pageNos[frame]);
+}
+
+
+int TwoQReplacer::order(int lists[])
+{
+  bool inFirst = this->lists.size(A1IN) > kin;
+  lists[0] = inFirst ? A1IN : AM;
+  lists[1] = inFirst ? AM : A1IN;
+  return 2;
+}
+
+
+// ARC: T1 holds pages referenced once recently, T2 pages referenced
+// at least twice, and the ghost lists B1 and B2 remember pages
+// replaced from T1 and T2. A page read in again while on B1 makes
+// the target size p of T1 grow, one on B2 makes it shrink. Pages are
+// replaced from T1 while it is larger than p.
+
+class ARCReplacer : public ListReplacer
+{
+ public:
+  ARCReplacer(const int frames)
+    : ListReplacer(frames, 3), ghosts(2 * frames, 2)
+  {
+    p = 0;
+  }
+
+ protected:
+  enum { T1 = 1, T2 = 2 };
+  enum { B1 = 0, B2 = 1 };
+
+  void load(const int frame);
+  void touch(const int frame);
+  void evict(const int frame);
+  int order(int lists[]);
+
+ private:
+  int p;                        // target size of T1
+  GhostDir ghosts;              // B1 and B2
+};
+
+
+void ARCReplacer::load(const int frame)
+{
+  int entry = ghosts.find(files[frame], pageNos[frame]);
+  if (entry < 0) {
+    lists.pushHead(T1, frame);
+    return;
+  }
+
+  int b1 = ghosts.size(B1);
+  int b2 = ghosts.size(B2);
+  if (ghosts.list(entry) == B1) {
+    int delta = b1 >= b2 ? 1 : b2 / b1;
+    p = p + delta < frames ? p + delta : frames;
+  }
+  else {
+    int delta = b2 >= b1 ? 1 : b1 / b2;
+    p = p - delta > 0 ? p - delta : 0;
+  }
+  ghosts.remove(entry);
+  lists.pushHead(T2, frame);
+}
+
+
+void ARCReplacer::touch(const int frame)
+{
+  lists.pushHead(T2, frame);
+}
+
+
+// Keep |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c.
+
+void ARCReplacer::evict(const int frame)
+{
+  if (lists.owner(frame) == T1) {
+    ghosts.add(B1, files[frame], pageNos[frame]);
+    while (lists.size(T1) - 1 + ghosts.size(B1) > frames)
+      ghosts.dropOldest(B1);
+  }
+  else {
+    ghosts.add(B2, files[frame], pageNos[frame]);
+    while (lists.size(T1) + lists.size(T2) - 1
+	   + ghosts.size(B1) + ghosts.size(B2) > 2 * frames)
+      ghosts.dropOldest(ghosts.size(B2) > 0 ? B2 : B1);
+  }
+}
+
+
+int ARCReplacer::order(int lists[])
+{
+  int t1 = this->lists.size(T1);
+  bool t1First = t1 > 0 && t1 > p;
+  lists[0] = t1First ? T1 : T2;
+  lists[1] = t1First ? T2 : T1;
+  return 2;
+}
+
+
+static const char* policyNames[] = { "clock", "lru2", "2q", "arc" };
+
+
+Replacer* Replacer::create(const ReplPolicy policy, const int frames)
+{
+  switch (policy) {
+  case LRU2:
+    return new LRU2Replacer(frames);
+  case TWOQ:
+    return new TwoQReplacer(frames);
+  case ARC:
+    return new ARCReplacer(frames);
+  default:
+    return new ClockReplacer(frames);
+  }
+}
+
+
+const char* Replacer::name(const ReplPolicy policy)
+{
+  return policyNames[policy];
+}
+
+
+bool Replacer::lookup(const char* name, ReplPolicy & policy)
+{
+  for (int i = 0; i <= ARC; i++)
+    if (strcasecmp(name, policyNames[i]) == 0) {
+      policy = (ReplPolicy)i;
+      return true;
+    }
+  return false;
+}
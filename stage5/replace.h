@@ -0,0 +1,65 @@
+#ifndef REPLACE_H
+#define REPLACE_H
+
+class File;
+
+// replacement policies of the buffer manager
+
+enum ReplPolicy { CLOCK, LRU2, TWOQ, ARC };
+
+// position of one search for a frame to replace; a search starts
+// with a fresh cursor
+
+struct ReplCursor
+{
+  int steps;    // # of candidates offered so far
+  int list;     // list being walked, policy specific
+  int frame;    // last candidate offered, -1 if none
+
+  ReplCursor() : steps(0), list(-1), frame(-1) {}
+};
+
+// A replacement policy decides which frame of the buffer pool gets a
+// page that is read in. The buffer manager tells it when a page is
+// loaded into a frame, referenced again while in the pool, replaced,
+// or dropped from the pool without being replaced (disposed, its file
+// flushed, or its read failed), and asks it for frames in the order
+// they should be replaced. A frame offered may turn out to be pinned
+// or busy, in which case the buffer manager asks for the next one.
+//
+// Any thread may call the policy. CLOCK works on atomic reference
+// bits; the others keep their lists under one lock, which every hit
+// takes.
+
+class Replacer
+{
+ public:
+  static Replacer* create(const ReplPolicy policy, const int frames);
+  static const char* name(const ReplPolicy policy);
+  static bool lookup(const char* name, ReplPolicy & policy);
+                                        // policy of given name
+
+  virtual ~Replacer() {}
+
+  // page (file, pageNo) was loaded into frame; referenced is false
+  // for a page read ahead of need, whose first use then counts as
+  // its first reference
+  virtual void loaded(const int frame, const File* file, const int pageNo,
+		      const bool referenced) = 0;
+  virtual void touched(const int frame) = 0;  // page in frame referenced
+  virtual void replaced(const int frame) = 0; // page evicted to make room
+  virtual void dropped(const int frame) = 0;  // page left pool otherwise
+
+  // next frame to try to replace, or -1 when there are no more
+  virtual int victim(ReplCursor & cursor) = 0;
+
+  // next frame victim would offer, without changing the policy's
+  // state, or -1; the background writer cleans these ahead of need.
+  // Only policies whose victim changes their state override it.
+  virtual int upcoming(ReplCursor & cursor)
+  {
+    return victim(cursor);
+  }
+};
+
+#endif
@@ -132,7 +132,7 @@ const Status ScanSelect(const string & result,
     outputRec.data = (void *) outputData;
     outputRec.length = reclen;
     // start scan on outer table
-    HeapFileScan relScan(attrDesc->relName, status);
+    HeapFileScan relScan(attrDesc->relName, status, ScanMode);
     if (status != OK) { return status; }
 
     status = relScan.startScan(attrDesc->attrOffset, attrDesc->attrLen, (Datatype) attrDesc->attrType, filter, op);
@@ -140,15 +140,13 @@ const Status ScanSelect(const string & result,
 
     // scan outer table
     RID relRID;
-    Record relRec;
     while (relScan.scanNext(relRID) == OK) {
-        status = relScan.getRecord(relRec);
-        ASSERT(status == OK);
-
-        // we have a match, copy data into the output record
+        // we have a match, copy the projected attributes, and only
+        // those, into the output record
         int outputOffset = 0;
         for (int i = 0; i < projCnt; i++) {
-            memcpy(outputData + outputOffset, (char *)relRec.data + projNames[i].attrOffset, projNames[i].attrLen);
+            status = relScan.getField(projNames[i].attrOffset, projNames[i].attrLen, outputData + outputOffset);
+            ASSERT(status == OK);
             outputOffset += projNames[i].attrLen;
        
         } // end copy attrs
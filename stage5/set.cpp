@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <strings.h>
+#include "utility.h"
+#include "page.h"
+#include "buf.h"
+
+extern BufMgr *bufMgr;
+
+
+//
+// Changes a setting of the running system. The only one is
+// bufferpool, the size of the buffer pool, either a # of frames or,
+// with a unit K, M or G, the # of bytes its pages may take. The
+// pool is resized at once; pages in frames given up are written out
+// if dirty.
+//
+// Returns:
+// 	OK on success
+// 	an error code otherwise
+//
+
+const Status UT_Set(const string & name, const int value, const char *unit)
+{
+  if (strcasecmp(name.c_str(), "bufferpool") != 0)
+    return BADSETTING;
+
+  Status status;
+  char size[32];
+  int frames;
+
+  snprintf(size, sizeof(size), "%d%s", value, unit ? unit : "");
+  if ((status = BufMgr::poolFrames(size, frames)) != OK)
+    return status;
+  if ((status = bufMgr->resize(frames)) != OK)
+    return status;
+
+  printf("buffer pool resized to %d frames (%d KB)\n", frames,
+	 (int)((long long)frames * PAGESIZE / 1024));
+  return OK;
+}
@@ -134,7 +134,7 @@ Status SortedFile::sortFile()
   // Open source file.
 
   // Start an unfiltered sequential scan.
-  hfs = new HeapFileScan(fileName, status);
+  hfs = new HeapFileScan(fileName, status, ScanMode);
   if (status != OK) return status;
 
   status = hfs->startScan(0, 0, STRING, NULL, EQ);
@@ -239,7 +239,9 @@ Status SortedFile::generateRun(int items)
     return status;                      // delete if successful
 
   // Open a heap file. This will also create the temporary file.
-  if (!(run.outFile = new InsertFileScan(run.name, status))) return INSUFMEM;
+  // Runs are read back once, so their pages are not cached.
+  if (!(run.outFile = new InsertFileScan(run.name, status, true)))
+    return INSUFMEM;
   if (status != OK) return status;
 
   // Open input file
@@ -279,9 +281,9 @@ Status SortedFile::startScans()
 
   for(run = runs.begin(); run != runs.end(); run++)
     {
-      run->inFile = new HeapFileScan(run->name, status);
+      run->inFile = new HeapFileScan(run->name, status, ScanMode);
       if (status != OK) return status;
-      status = (run->inFile)->startScan(0, 0, STRING, NULL, EQ);
+      status = (run->inFile)->startScan(0, 0, STRING, NULL, EQ, true);
       if (status != OK) return status;
 
       run->valid = false;
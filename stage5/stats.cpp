@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <algorithm>
+#include "catalog.h"
+#include "utility.h"
+#include "page.h"
+#include "buf.h"
+
+extern BufMgr *bufMgr;
+
+
+// orders files by name
+
+static bool nameLess(const File* f1, const File* f2)
+{
+  return f1->getName() < f2->getName();
+}
+
+
+// upper bound in us of a latency bucket, as text
+
+static const char* bucketName(const int bucket, char* name, const int size)
+{
+  if (bucket == LATENCYBUCKETS - 1)
+    snprintf(name, size, "inf");
+  else
+    snprintf(name, size, "%lld", 1LL << bucket);
+  return name;
+}
+
+
+static double percent(const long long part, const long long whole)
+{
+  return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+
+//
+// Writes the buffer pool counters as lines of a key and a value to
+// out: first those of the pool, then the latency histograms, one line
+// per bucket named by its upper bound in us, then the counters of
+// each file.
+//
+
+static void writeStats(FILE *out, const vector<File*> & files)
+{
+  const BufStats & stats = bufMgr->getBufStats();
+  char name[32];
+
+  fprintf(out, "frames %d\n", bufMgr->numFrames());
+  fprintf(out, "pagesize %d\n", (int)PAGESIZE);
+  fprintf(out, "accesses %lld\n", stats.accesses);
+  fprintf(out, "hits %lld\n", stats.accesses - stats.misses);
+  fprintf(out, "readahead_hits %lld\n", stats.readAheadHits);
+  fprintf(out, "misses %lld\n", stats.misses);
+  fprintf(out, "diskreads %lld\n", stats.diskreads);
+  fprintf(out, "diskwrites %lld\n", stats.diskwrites);
+  fprintf(out, "bgwrites %lld\n", stats.bgwrites);
+  fprintf(out, "checkpoints %lld\n", stats.checkpoints);
+  fprintf(out, "evictions %lld\n", stats.evictions);
+  fprintf(out, "clean_evictions %lld\n",
+	  stats.evictions - stats.dirtyEvictions);
+  fprintf(out, "dirty_evictions %lld\n", stats.dirtyEvictions);
+  fprintf(out, "ring_evictions %lld\n", stats.ringEvictions);
+  fprintf(out, "pin_waits %lld\n", stats.pinWaits);
+  fprintf(out, "pin_wait_ns %lld\n", stats.pinWaitNanos);
+  for (int i = 0; i < LATENCYBUCKETS; i++)
+    fprintf(out, "read_latency_us.%s %lld\n",
+	    bucketName(i, name, sizeof(name)), stats.readLatency[i]);
+  for (int i = 0; i < LATENCYBUCKETS; i++)
+    fprintf(out, "write_latency_us.%s %lld\n",
+	    bucketName(i, name, sizeof(name)), stats.writeLatency[i]);
+
+  for (unsigned i = 0; i < files.size(); i++) {
+    const char *file = files[i]->getName().c_str();
+    const BufFileStats & fstats = files[i]->getBufStats();
+    fprintf(out, "file.%s.hits %lld\n", file, fstats.hits);
+    fprintf(out, "file.%s.misses %lld\n", file, fstats.misses);
+    fprintf(out, "file.%s.evictions %lld\n", file, fstats.evictions);
+    fprintf(out, "file.%s.dirty_evictions %lld\n", file,
+	    fstats.dirtyEvictions);
+  }
+}
+
+
+//
+// Prints the buffer pool counters as a report.
+//
+
+static void printStats(const vector<File*> & files)
+{
+  const BufStats & stats = bufMgr->getBufStats();
+  long long hits = stats.accesses - stats.misses;
+  char name[32];
+
+  printf("buffer pool: %d frames (%lld KB)\n", bufMgr->numFrames(),
+	 (long long)bufMgr->numFrames() * PAGESIZE / 1024);
+  printf("accesses %lld, hits %lld (%.1f%%, %lld on pages read ahead), "
+	 "misses %lld\n", stats.accesses, hits,
+	 percent(hits, stats.accesses), stats.readAheadHits, stats.misses);
+  printf("pages read %lld, written %lld (%lld in the background), "
+	 "checkpoints %lld\n", stats.diskreads, stats.diskwrites,
+	 stats.bgwrites, stats.checkpoints);
+  printf("evictions %lld: %lld clean, %lld dirty, %lld by rings\n",
+	 stats.evictions, stats.evictions - stats.dirtyEvictions,
+	 stats.dirtyEvictions, stats.ringEvictions);
+  printf("pin waits %lld, %.3f ms in all\n", stats.pinWaits,
+	 stats.pinWaitNanos / 1e6);
+
+  // latency histograms, up to the slowest bucket used
+
+  int last = -1;
+  for (int i = 0; i < LATENCYBUCKETS; i++)
+    if (stats.readLatency[i] || stats.writeLatency[i])
+      last = i;
+  if (last >= 0) {
+    printf("\n%-12s %12s %12s\n", "latency", "reads", "writes");
+    for (int i = 0; i <= last; i++) {
+      char bound[40];
+      if (i == LATENCYBUCKETS - 1)
+	snprintf(bound, sizeof(bound), ">= %lld us", 1LL << (i - 1));
+      else
+	snprintf(bound, sizeof(bound), "< %s us",
+		 bucketName(i, name, sizeof(name)));
+      printf("%-12s %12lld %12lld\n", bound, stats.readLatency[i],
+	     stats.writeLatency[i]);
+    }
+  }
+
+  if (files.empty())
+    return;
+  printf("\n%-20s %10s %10s %6s %10s %10s\n", "file", "hits", "misses",
+	 "hit %", "evictions", "dirty");
+  for (unsigned i = 0; i < files.size(); i++) {
+    const BufFileStats & fstats = files[i]->getBufStats();
+    printf("%-20s %10lld %10lld %6.1f %10lld %10lld\n",
+	   files[i]->getName().c_str(), fstats.hits, fstats.misses,
+	   percent(fstats.hits, fstats.hits + fstats.misses),
+	   fstats.evictions, fstats.dirtyEvictions);
+  }
+}
+
+
+//
+// Reports the buffer pool counters: hits and misses, evictions,
+// waits for pages being transferred and transfer latencies, in all
+// and for each file the database has open or keeps cached; each
+// relation is one file. With a relation, only that relation's file
+// is listed. With a file name, the counters are written to that file
+// as lines of a key and a value instead of being printed.
+//
+// Returns:
+// 	OK on success
+// 	an error code otherwise
+//
+
+const Status UT_Stats(const char *relation, const char *fileName)
+{
+  Status status;
+  vector<File*> files;
+  vector<File*> listed;
+
+  if (relation) {
+    RelDesc rd;
+    if ((status = relCat->getInfo(relation, rd)) != OK)
+      return status;
+  }
+
+  db.listFiles(files);
+  for (unsigned i = 0; i < files.size(); i++)
+    if (!relation || files[i]->getName() == relation)
+      listed.push_back(files[i]);
+  sort(listed.begin(), listed.end(), nameLess);
+
+  if (!fileName) {
+    printStats(listed);
+    return OK;
+  }
+
+  FILE *out = fopen(fileName, "w");
+  if (!out)
+    return UNIXERR;
+  writeStats(out, listed);
+  if (fclose(out) != 0)
+    return UNIXERR;
+  return OK;
+}
@@ -27,6 +27,12 @@ const Status UT_Load(const string & relation,
 
 const Status UT_Print(string relation);
 
+const Status UT_Set(const string & name, const int value, const char *unit);
+
+const Status UT_Stats(const char *relation, const char *fileName);
+
+const Status UT_Vacuum(const string & relation, const int pages);
+
 void   UT_Quit(void);
 
 #endif
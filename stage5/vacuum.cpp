@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include "catalog.h"
+#include "utility.h"
+
+
+//
+// Compacts a relation: its records are moved to the pages nearer the
+// start of its file that have room, and the pages emptied are given
+// back to the file's free space, to be reused as it grows. With pages,
+// only that many pages are gone through, going on from where the last
+// such step stopped, so that a large relation can be vacuumed a
+// little at a time between queries; 0 goes through all of them.
+// The catalogs cannot be vacuumed.
+//
+// Returns:
+// 	OK on success
+// 	an error code otherwise
+//
+
+const Status UT_Vacuum(const string & relation, const int pages)
+{
+  Status status;
+  RelDesc rd;
+  int examined, moved, freed;
+
+  // the catalogs keep pages of their files pinned while open
+
+  if (relation.empty() || pages < 0 ||
+      relation == string(RELCATNAME) ||
+      relation == string(ATTRCATNAME))
+    return BADCATPARM;
+  if ((status = relCat->getInfo(relation, rd)) != OK)
+    return status;
+
+  HeapFile hfile(relation, status);
+  if (status != OK)
+    return status;
+  if ((status = hfile.vacuum(pages, examined, moved, freed)) != OK)
+    return status;
+
+  printf("vacuumed %s: %d pages gone through, %d records moved, "
+	 "%d pages (%d KB) reclaimed\n", relation.c_str(), examined, moved,
+	 freed, (int)((long long)freed * PAGESIZE / 1024));
+  return OK;
+}